@@ -0,0 +1,217 @@
+/* ResidualVM - A 3D game interpreter
+ *
+ * ResidualVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the AUTHORS
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#include "backends/graphics/headless/headless-graphics.h"
+
+#include "common/config-manager.h"
+#include "common/fs.h"
+#include "common/md5.h"
+#include "common/memstream.h"
+#include "common/textconsole.h"
+
+HeadlessGraphicsManager::HeadlessGraphicsManager()
+	:
+	_format(2, 5, 6, 5, 0, 11, 5, 0, 0),
+	_width(0), _height(0),
+	_screen(0),
+	_overlay(0),
+	_overlayVisible(false),
+	_screenChangeCount(0),
+	_frameCount(0) {
+
+	_dumpInterval = ConfMan.getInt("frame_dump_interval");
+	_dumpMode = ConfMan.get("frame_dump_mode");
+	_dumpPath = ConfMan.get("frame_dump_path");
+
+	if (_dumpInterval > 0 && _dumpMode != "ppm" && _dumpMode != "raw" && _dumpMode != "md5") {
+		warning("Unknown frame dump mode '%s', using md5", _dumpMode.c_str());
+		_dumpMode = "md5";
+	}
+	if (_dumpInterval > 0 && _dumpMode == "md5") {
+		Common::FSNode node = Common::FSNode(_dumpPath).getChild("frames.md5");
+		if (!_hashFile.open(node))
+			warning("Could not open %s, frame hashes won't be written", node.getPath().c_str());
+	}
+}
+
+HeadlessGraphicsManager::~HeadlessGraphicsManager() {
+	_hashFile.close();
+	delete[] _screen;
+	delete[] _overlay;
+}
+
+bool HeadlessGraphicsManager::hasFeature(OSystem::Feature f) {
+	// nothing to create an OpenGL context on
+	return false;
+}
+
+void HeadlessGraphicsManager::setFeatureState(OSystem::Feature f, bool enable) {
+}
+
+bool HeadlessGraphicsManager::getFeatureState(OSystem::Feature f) {
+	return false;
+}
+
+void HeadlessGraphicsManager::launcherInitSize(uint w, uint h) {
+	setupScreen(w, h, false, false);
+}
+
+byte *HeadlessGraphicsManager::setupScreen(int screenW, int screenH, bool fullscreen, bool accel3d) {
+	if (accel3d)
+		error("The headless mode has no 3D acceleration, use the software renderer");
+
+	delete[] _screen;
+	delete[] _overlay;
+	_width = screenW;
+	_height = screenH;
+	_screen = new uint16[_width * _height];
+	_overlay = new uint16[_width * _height];
+	memset(_screen, 0, _width * _height * 2);
+	memset(_overlay, 0, _width * _height * 2);
+
+	_screenChangeCount++;
+
+	return (byte *)_screen;
+}
+
+void HeadlessGraphicsManager::updateScreen() {
+	if (!_screen)
+		return;
+
+	_frameCount++;
+	if (_dumpInterval > 0 && _frameCount % _dumpInterval == 0)
+		dumpFrame(_overlayVisible ? _overlay : _screen);
+}
+
+void HeadlessGraphicsManager::dumpFrame(const uint16 *pixels) {
+	uint32 size = _width * _height * 2;
+
+	if (_dumpMode == "md5") {
+		Common::MemoryReadStream stream((const byte *)pixels, size);
+		Common::String line = Common::String::format("%u %s\n", _frameCount, Common::computeStreamMD5AsString(stream).c_str());
+		_hashFile.write(line.c_str(), line.size());
+		_hashFile.flush();
+		return;
+	}
+
+	Common::String name = Common::String::format("frame%06u.%s", _frameCount, _dumpMode.c_str());
+	Common::FSNode node = Common::FSNode(_dumpPath).getChild(name);
+	Common::DumpFile file;
+	if (!file.open(node)) {
+		warning("Could not open %s", node.getPath().c_str());
+		return;
+	}
+
+	if (_dumpMode == "raw") {
+		// the 5R6G5B pixels as they are in memory
+		file.write(pixels, size);
+		return;
+	}
+
+	Common::String header = Common::String::format("P6\n%d %d\n255\n", _width, _height);
+	file.write(header.c_str(), header.size());
+	byte *line = new byte[_width * 3];
+	for (int y = 0; y < _height; y++) {
+		for (int x = 0; x < _width; x++)
+			_format.colorToRGB(pixels[y * _width + x], line[x * 3], line[x * 3 + 1], line[x * 3 + 2]);
+		file.write(line, _width * 3);
+	}
+	delete[] line;
+}
+
+#pragma mark -
+#pragma mark --- Overlays ---
+#pragma mark -
+
+void HeadlessGraphicsManager::showOverlay() {
+	if (_overlayVisible)
+		return;
+
+	_overlayVisible = true;
+
+	clearOverlay();
+}
+
+void HeadlessGraphicsManager::hideOverlay() {
+	if (!_overlayVisible)
+		return;
+
+	_overlayVisible = false;
+
+	clearOverlay();
+}
+
+void HeadlessGraphicsManager::clearOverlay() {
+	if (!_overlayVisible || !_overlay)
+		return;
+
+	// the overlay starts as the game screen, as on a real display
+	memcpy(_overlay, _screen, _width * _height * 2);
+}
+
+void HeadlessGraphicsManager::grabOverlay(OverlayColor *buf, int pitch) {
+	if (!_overlay)
+		return;
+
+	const uint16 *src = _overlay;
+	for (int y = 0; y < _height; y++) {
+		memcpy(buf, src, _width * 2);
+		src += _width;
+		buf += pitch;
+	}
+}
+
+void HeadlessGraphicsManager::copyRectToOverlay(const OverlayColor *buf, int pitch, int x, int y, int w, int h) {
+	if (!_overlay)
+		return;
+
+	// Clip the coordinates
+	if (x < 0) {
+		w += x;
+		buf -= x;
+		x = 0;
+	}
+
+	if (y < 0) {
+		h += y;
+		buf -= y * pitch;
+		y = 0;
+	}
+
+	if (w > _width - x) {
+		w = _width - x;
+	}
+
+	if (h > _height - y) {
+		h = _height - y;
+	}
+
+	if (w <= 0 || h <= 0)
+		return;
+
+	uint16 *dst = _overlay + y * _width + x;
+	do {
+		memcpy(dst, buf, w * 2);
+		dst += _width;
+		buf += pitch;
+	} while (--h);
+}
@@ -0,0 +1,88 @@
+/* ResidualVM - A 3D game interpreter
+ *
+ * ResidualVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the AUTHORS
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#ifndef BACKENDS_GRAPHICS_HEADLESS_H
+#define BACKENDS_GRAPHICS_HEADLESS_H
+
+#include "backends/graphics/graphics.h"
+#include "graphics/pixelformat.h"
+#include "common/file.h"
+#include "common/str.h"
+
+/**
+ * Graphics manager drawing to memory only, for machines with no display.
+ *
+ * The screen is a 5R6G5B buffer nothing shows, so only the software
+ * renderer can use it. Every few frames the screen can be written out,
+ * as a PPM or a raw image, or as the MD5 of its pixels. That's set with
+ * the "frame_dump_interval", "frame_dump_mode" (ppm, raw or md5) and
+ * "frame_dump_path" settings.
+ */
+class HeadlessGraphicsManager : public GraphicsManager {
+public:
+	HeadlessGraphicsManager();
+	virtual ~HeadlessGraphicsManager();
+
+	virtual bool hasFeature(OSystem::Feature f);
+	virtual void setFeatureState(OSystem::Feature f, bool enable);
+	virtual bool getFeatureState(OSystem::Feature f);
+
+	virtual void launcherInitSize(uint w, uint h);
+	byte *setupScreen(int screenW, int screenH, bool fullscreen, bool accel3d);
+	virtual int getScreenChangeID() const { return _screenChangeCount; }
+	virtual int16 getHeight() { return _height; }
+	virtual int16 getWidth() { return _width; }
+
+	virtual void updateScreen();
+
+	virtual void showOverlay();
+	virtual void hideOverlay();
+	virtual Graphics::PixelFormat getOverlayFormat() const { return _format; }
+	virtual void clearOverlay();
+	virtual void grabOverlay(OverlayColor *buf, int pitch);
+	virtual void copyRectToOverlay(const OverlayColor *buf, int pitch, int x, int y, int w, int h);
+	virtual int16 getOverlayHeight() { return _height; }
+	virtual int16 getOverlayWidth() { return _width; }
+
+	virtual bool showMouse(bool visible) { return true; }
+	virtual void warpMouse(int x, int y) {}
+	virtual void setMouseCursor(const byte *buf, uint w, uint h, int hotspotX, int hotspotY, uint32 keycolor, int cursorTargetScale = 1, const Graphics::PixelFormat *format = NULL) {}
+
+protected:
+	void dumpFrame(const uint16 *pixels);
+
+	Graphics::PixelFormat _format;
+	int _width, _height;
+	uint16 *_screen;
+	uint16 *_overlay;
+	bool _overlayVisible;
+	int _screenChangeCount;
+
+	uint32 _frameCount;
+	int _dumpInterval;
+	Common::String _dumpMode;
+	Common::String _dumpPath;
+	// one line per dumped frame in the md5 mode
+	Common::DumpFile _hashFile;
+};
+
+#endif
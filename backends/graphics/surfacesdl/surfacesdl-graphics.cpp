@@ -29,6 +29,7 @@
 #include "backends/platform/sdl/sdl.h"
 #include "common/config-manager.h"
 #include "common/mutex.h"
+#include "common/rect.h"
 #include "common/textconsole.h"
 #include "common/translation.h"
 #include "common/util.h"
@@ -48,6 +49,7 @@ SurfaceSdlGraphicsManager::SurfaceSdlGraphicsManager(SdlEventSource *sdlEventSou
 	_overlayscreen(0),
 	_overlayWidth(0), _overlayHeight(0),
 	_overlayDirty(true),
+	_forceFull(true),
 	_screenChangeCount(0)
 #ifdef USE_OPENGL
 	, _overlayNumTex(0), _overlayTexIds(0)
@@ -238,6 +240,7 @@ byte *SurfaceSdlGraphicsManager::setupScreen(int screenW, int screenH, bool full
 	_overlayFormat.aShift = _overlayscreen->format->Ashift;
 
 	_screenChangeCount++;
+	_forceFull = true;
 
 	return (byte *)_screen->pixels;
 }
@@ -361,6 +364,38 @@ void SurfaceSdlGraphicsManager::updateScreen() {
 		}
 		SDL_Flip(_screen);
 	}
+	_forceFull = false;
+}
+
+void SurfaceSdlGraphicsManager::updateScreenRects(const Common::Rect *rects, int count) {
+	// The overlay is copied over the whole screen, and double buffered or
+	// OpenGL screens can only be presented as a whole
+	bool full = _forceFull || _overlayVisible || (_screen->flags & SDL_DOUBLEBUF);
+#ifdef USE_OPENGL
+	full = full || _opengl;
+#endif
+	if (full) {
+		updateScreen();
+		return;
+	}
+
+	_updateRects.clear();
+	for (int i = 0; i < count; i++) {
+		Common::Rect r = rects[i];
+		r.clip(_screen->w, _screen->h);
+		if (r.isEmpty())
+			continue;
+
+		SDL_Rect sdlRect;
+		sdlRect.x = r.left;
+		sdlRect.y = r.top;
+		sdlRect.w = r.width();
+		sdlRect.h = r.height();
+		_updateRects.push_back(sdlRect);
+	}
+
+	if (!_updateRects.empty())
+		SDL_UpdateRects(_screen, _updateRects.size(), &_updateRects[0]);
 }
 
 int16 SurfaceSdlGraphicsManager::getHeight() {
@@ -391,6 +426,8 @@ void SurfaceSdlGraphicsManager::hideOverlay() {
 		return;
 
 	_overlayVisible = false;
+	// the overlay was drawn over the whole screen
+	_forceFull = true;
 
 	clearOverlay();
 }
@@ -32,6 +32,7 @@
 #include "backends/graphics/sdl/sdl-graphics.h"
 #include "graphics/pixelformat.h"
 #include "graphics/scaler.h"
+#include "common/array.h"
 #include "common/events.h"
 #include "common/system.h"
 
@@ -66,6 +67,7 @@ public:
 
 public:
 	virtual void updateScreen();
+	virtual void updateScreenRects(const Common::Rect *rects, int count);
 
 	virtual void showOverlay();
 	virtual void hideOverlay();
@@ -122,6 +124,7 @@ protected:
 
 	/** Force full redraw on next updateScreen */
 	bool _forceFull;
+	Common::Array<SDL_Rect> _updateRects;
 
 	int _screenChangeCount;
 };
@@ -88,6 +88,10 @@ void ModularBackend::updateScreen() {
 	_graphicsManager->updateScreen();
 }
 
+void ModularBackend::updateScreenRects(const Common::Rect *rects, int count) {
+	_graphicsManager->updateScreenRects(rects, count);
+}
+
 void ModularBackend::showOverlay() {
 	_graphicsManager->showOverlay();
 }
@@ -152,6 +156,41 @@ void ModularBackend::deleteMutex(MutexRef mutex) {
 	_mutexManager->deleteMutex(mutex);
 }
 
+OSystem::ThreadRef ModularBackend::createThread(ThreadProc proc, void *arg) {
+	assert(_mutexManager);
+	return _mutexManager->createThread(proc, arg);
+}
+
+void ModularBackend::joinThread(ThreadRef thread) {
+	assert(_mutexManager);
+	_mutexManager->joinThread(thread);
+}
+
+OSystem::ConditionRef ModularBackend::createCondition() {
+	assert(_mutexManager);
+	return _mutexManager->createCondition();
+}
+
+void ModularBackend::waitCondition(ConditionRef cond, MutexRef mutex) {
+	assert(_mutexManager);
+	_mutexManager->waitCondition(cond, mutex);
+}
+
+void ModularBackend::signalCondition(ConditionRef cond) {
+	assert(_mutexManager);
+	_mutexManager->signalCondition(cond);
+}
+
+void ModularBackend::deleteCondition(ConditionRef cond) {
+	assert(_mutexManager);
+	_mutexManager->deleteCondition(cond);
+}
+
+int ModularBackend::getCPUCount() {
+	assert(_mutexManager);
+	return _mutexManager->getCPUCount();
+}
+
 Audio::Mixer *ModularBackend::getMixer() {
 	assert(_mixer);
 	return (Audio::Mixer *)_mixer;
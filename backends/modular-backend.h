@@ -69,6 +69,7 @@ public:
 	virtual int16 getHeight();
 	virtual int16 getWidth();
 	virtual void updateScreen();
+	virtual void updateScreenRects(const Common::Rect *rects, int count);
 
 	virtual void showOverlay();
 	virtual void hideOverlay();
@@ -102,6 +103,19 @@ public:
 
 	//@}
 
+	/** @name Worker threads */
+	//@{
+
+	virtual ThreadRef createThread(ThreadProc proc, void *arg);
+	virtual void joinThread(ThreadRef thread);
+	virtual ConditionRef createCondition();
+	virtual void waitCondition(ConditionRef cond, MutexRef mutex);
+	virtual void signalCondition(ConditionRef cond);
+	virtual void deleteCondition(ConditionRef cond);
+	virtual int getCPUCount();
+
+	//@}
+
 	/** @name Sound */
 	//@{
 
@@ -29,6 +29,9 @@
 /**
  * Abstract class for mutex manager. Subclasses
  * implement the real functionality.
+ *
+ * The manager also offers the worker threads and their condition variables,
+ * which go along with the mutexes. By default there are none.
  */
 class MutexManager : Common::NonCopyable {
 public:
@@ -38,6 +41,14 @@ public:
 	virtual void lockMutex(OSystem::MutexRef mutex) = 0;
 	virtual void unlockMutex(OSystem::MutexRef mutex) = 0;
 	virtual void deleteMutex(OSystem::MutexRef mutex) = 0;
+
+	virtual OSystem::ThreadRef createThread(OSystem::ThreadProc proc, void *arg) { return 0; }
+	virtual void joinThread(OSystem::ThreadRef thread) {}
+	virtual OSystem::ConditionRef createCondition() { return 0; }
+	virtual void waitCondition(OSystem::ConditionRef cond, OSystem::MutexRef mutex) {}
+	virtual void signalCondition(OSystem::ConditionRef cond) {}
+	virtual void deleteCondition(OSystem::ConditionRef cond) {}
+	virtual int getCPUCount() { return 1; }
 };
 
 #endif
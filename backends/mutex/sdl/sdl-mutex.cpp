@@ -44,4 +44,40 @@ void SdlMutexManager::deleteMutex(OSystem::MutexRef mutex) {
 	SDL_DestroyMutex((SDL_mutex *) mutex);
 }
 
+OSystem::ThreadRef SdlMutexManager::createThread(OSystem::ThreadProc proc, void *arg) {
+#if SDL_VERSION_ATLEAST(1, 3, 0)
+	return (OSystem::ThreadRef) SDL_CreateThread(proc, "worker", arg);
+#else
+	return (OSystem::ThreadRef) SDL_CreateThread(proc, arg);
+#endif
+}
+
+void SdlMutexManager::joinThread(OSystem::ThreadRef thread) {
+	SDL_WaitThread((SDL_Thread *) thread, NULL);
+}
+
+OSystem::ConditionRef SdlMutexManager::createCondition() {
+	return (OSystem::ConditionRef) SDL_CreateCond();
+}
+
+void SdlMutexManager::waitCondition(OSystem::ConditionRef cond, OSystem::MutexRef mutex) {
+	SDL_CondWait((SDL_cond *) cond, (SDL_mutex *) mutex);
+}
+
+void SdlMutexManager::signalCondition(OSystem::ConditionRef cond) {
+	SDL_CondBroadcast((SDL_cond *) cond);
+}
+
+void SdlMutexManager::deleteCondition(OSystem::ConditionRef cond) {
+	SDL_DestroyCond((SDL_cond *) cond);
+}
+
+int SdlMutexManager::getCPUCount() {
+#if SDL_VERSION_ATLEAST(1, 3, 0)
+	return SDL_GetCPUCount();
+#else
+	return 1;
+#endif
+}
+
 #endif
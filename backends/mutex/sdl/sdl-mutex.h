@@ -34,6 +34,14 @@ public:
 	virtual void lockMutex(OSystem::MutexRef mutex);
 	virtual void unlockMutex(OSystem::MutexRef mutex);
 	virtual void deleteMutex(OSystem::MutexRef mutex);
+
+	virtual OSystem::ThreadRef createThread(OSystem::ThreadProc proc, void *arg);
+	virtual void joinThread(OSystem::ThreadRef thread);
+	virtual OSystem::ConditionRef createCondition();
+	virtual void waitCondition(OSystem::ConditionRef cond, OSystem::MutexRef mutex);
+	virtual void signalCondition(OSystem::ConditionRef cond);
+	virtual void deleteCondition(OSystem::ConditionRef cond);
+	virtual int getCPUCount();
 };
 
 
@@ -47,6 +47,7 @@
 #include "backends/mutex/sdl/sdl-mutex.h"
 #include "backends/timer/sdl/sdl-timer.h"
 #include "backends/graphics/surfacesdl/surfacesdl-graphics.h"
+#include "backends/graphics/headless/headless-graphics.h"
 
 #include "icons/residualvm.xpm"
 
@@ -138,6 +139,10 @@ void OSystem_SDL::initBackend() {
 	int graphicsManagerType = 0;
 
 	if (_graphicsManager == 0) {
+		if (ConfMan.getBool("headless")) {
+			_graphicsManager = new HeadlessGraphicsManager();
+			graphicsManagerType = 1;
+		}
 		if (_graphicsManager == 0) {
 			_graphicsManager = new SurfaceSdlGraphicsManager(_eventSource);
 			graphicsManagerType = 0;
@@ -101,7 +101,23 @@ static const char HELP_STRING[] =
 	"  --output-rate=RATE       Select output sample rate in Hz (e.g. 22050)\n"
 	"  --opl-driver=DRIVER      Select AdLib (OPL) emulator (db, mame)\n"
 	"  --show-fps=BOOL          Set the turn on/off display FPS info: true/false\n"
+	"  --show-frame-times       Display the times of the phases of the frames\n"
+	"  --frame-times-log=FILE   Write the times of every frame to FILE, as CSV or,\n"
+	"                           for a .json FILE, as a Chrome trace\n"
 	"  --soft-renderer=BOOL     Set the turn on/off software 3D renderer: true/false\n"
+	"  --tinygl-threads=NUM     Rasterize on NUM threads with the software renderer\n"
+	"                           (default: -1, one per processor up to 4)\n"
+	"  --engine-speed=NUM       Set the frames per second, 0 for no limit\n"
+	"                           (default: 30)\n"
+	"  --simulation-rate=NUM    Update the game NUM times per second, whatever the\n"
+	"                           frame rate (default: 0, once per frame)\n"
+	"  --interpolate-actors     Draw the actors between their last two updates,\n"
+	"                           with a simulation rate set\n"
+	"  --headless               Render to memory only, with no window\n"
+	"  --frame-dump-interval=NUM\n"
+	"                           Write out every NUM-th frame when headless\n"
+	"  --frame-dump-mode=MODE   Write the frames as ppm, raw or md5 (default: md5)\n"
+	"  --frame-dump-path=PATH   Path where the frames are written\n"
 	"\n"
 	"  --dimuse-tempo=NUM       Set internal Digital iMuse tempo (10 - 100) per second\n"
 	"                           (default: 10)\n"
@@ -134,7 +150,16 @@ void registerDefaults() {
 	// Graphics
 	ConfMan.registerDefault("fullscreen", false);
 	ConfMan.registerDefault("soft_renderer", "false");
+	ConfMan.registerDefault("tinygl_threads", -1);
 	ConfMan.registerDefault("show_fps", "false");
+	ConfMan.registerDefault("show_frame_times", false);
+	ConfMan.registerDefault("frame_times_log", "");
+	ConfMan.registerDefault("simulation_rate", 0);
+	ConfMan.registerDefault("interpolate_actors", false);
+	ConfMan.registerDefault("headless", false);
+	ConfMan.registerDefault("frame_dump_interval", 0);
+	ConfMan.registerDefault("frame_dump_mode", "md5");
+	ConfMan.registerDefault("frame_dump_path", ".");
 
 	// Sound & Music
 	ConfMan.registerDefault("music_volume", 127);
@@ -402,6 +427,33 @@ Common::String parseCommandLine(Common::StringMap &settings, int argc, const cha
 			DO_LONG_OPTION("show-fps")
 			END_OPTION
 
+			DO_LONG_OPTION_BOOL("show-frame-times")
+			END_OPTION
+
+			DO_LONG_OPTION("frame-times-log")
+			END_OPTION
+
+			DO_LONG_OPTION_INT("simulation-rate")
+			END_OPTION
+
+			DO_LONG_OPTION_INT("tinygl-threads")
+			END_OPTION
+
+			DO_LONG_OPTION_BOOL("interpolate-actors")
+			END_OPTION
+
+			DO_LONG_OPTION_BOOL("headless")
+			END_OPTION
+
+			DO_LONG_OPTION_INT("frame-dump-interval")
+			END_OPTION
+
+			DO_LONG_OPTION("frame-dump-mode")
+			END_OPTION
+
+			DO_LONG_OPTION("frame-dump-path")
+			END_OPTION
+
 			DO_LONG_OPTION("savepath")
 				Common::FSNode path(option);
 				if (!path.exists()) {
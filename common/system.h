@@ -344,6 +344,16 @@ public:
 	 */
 	virtual void updateScreen() = 0;
 
+	/**
+	 * Flush only the given regions of the screen framebuffer to the display.
+	 * The rest of the framebuffer must not have changed since the last
+	 * update. Backends that can't present part of the screen update it all.
+	 *
+	 * @param rects		the regions that changed
+	 * @param count		the number of regions
+	 */
+	virtual void updateScreenRects(const Common::Rect *rects, int count) { updateScreen(); }
+
 	//@}
 
 
@@ -570,6 +580,69 @@ public:
 
 
 
+	/**
+	 * @name Worker threads
+	 * The engines still don't get threads of their own. These are only
+	 * meant for pure computation split among the processors, such as
+	 * software rendering, which the calling code finishes before it goes
+	 * on. The threads must not call any other OSystem method than the mutex
+	 * and condition ones.
+	 *
+	 * Backends are free not to offer them: createThread() then returns 0,
+	 * and the calling code has to do the work by itself.
+	 */
+	//@{
+
+	typedef struct OpaqueThread *ThreadRef;
+	typedef struct OpaqueCondition *ConditionRef;
+	typedef int (*ThreadProc)(void *arg);
+
+	/**
+	 * Start a worker thread.
+	 * @param proc	the function the thread runs.
+	 * @param arg	passed to proc.
+	 * @return the thread, or 0 if threads are unsupported or an error occurred.
+	 */
+	virtual ThreadRef createThread(ThreadProc proc, void *arg) { return 0; }
+
+	/**
+	 * Wait for a thread to return, and release it.
+	 * @param thread	the thread to join.
+	 */
+	virtual void joinThread(ThreadRef thread) {}
+
+	/**
+	 * Create a new condition variable.
+	 * @return the newly created condition, or 0 if an error occurred.
+	 */
+	virtual ConditionRef createCondition() { return 0; }
+
+	/**
+	 * Unlock the mutex, wait for the condition to be signaled, then lock the
+	 * mutex again. The mutex must be locked exactly once by the caller.
+	 * Like with any condition variable, the wait may end spuriously.
+	 */
+	virtual void waitCondition(ConditionRef cond, MutexRef mutex) {}
+
+	/**
+	 * Wake all the threads waiting on the condition.
+	 */
+	virtual void signalCondition(ConditionRef cond) {}
+
+	/**
+	 * Delete the given condition. No thread may be waiting on it.
+	 */
+	virtual void deleteCondition(ConditionRef cond) {}
+
+	/**
+	 * Return the number of processors, 1 when unknown.
+	 */
+	virtual int getCPUCount() { return 1; }
+
+	//@}
+
+
+
 	/** @name Sound */
 	//@{
 
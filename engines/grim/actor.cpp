@@ -56,7 +56,8 @@ Actor::Actor(const Common::String &actorName) :
 		// _turnRate so Doug at the cat races can turn and we set the
 		// _walkRate so Glottis at the demon beaver entrance can walk and
 		// so Chepito in su.set
-		_pitch(0), _yaw(0), _roll(0), _walkRate(0.3f), _turnRate(100.0f),
+		_pitch(0), _yaw(0), _roll(0), _prevPos(0, 0, 0), _prevPitch(0), _prevYaw(0), _prevRoll(0),
+		_walkRate(0.3f), _turnRate(100.0f),
 		_reflectionAngle(80),
 		_visible(true), _lipSync(NULL), _turning(false), _walking(false),
 		_walkedLast(false), _walkedCur(false),
@@ -248,6 +249,7 @@ bool Actor::restoreState(SaveGame *savedState) {
 	_pitch              = savedState->readFloat();
 	_yaw                = savedState->readFloat();
 	_roll               = savedState->readFloat();
+	saveDrawTransform();
 	_walkRate           = savedState->readFloat();
 	_turnRate           = savedState->readFloat();
 	_constrain          = savedState->readLESint32();
@@ -388,6 +390,8 @@ void Actor::setPos(const Math::Vector3d &position) {
 	if (_constrain && !_walking) {
 		g_grim->getCurrSet()->findClosestSector(_pos, NULL, &_pos);
 	}
+	// the actor is put there, not moved there
+	_prevPos = _pos;
 }
 
 void Actor::turnTo(const Math::Angle &pitchParam, const Math::Angle &yawParam, const Math::Angle &rollParam) {
@@ -1156,7 +1160,30 @@ void Actor::update(uint frameTime) {
 	}
 }
 
-void Actor::draw() {
+void Actor::saveDrawTransform() {
+	_prevPos = _pos;
+	_prevPitch = _pitch;
+	_prevYaw = _yaw;
+	_prevRoll = _roll;
+}
+
+static Math::Angle interpolateAngle(const Math::Angle &from, const Math::Angle &to, float t) {
+	// turn the short way round
+	Math::Angle delta = to - from;
+	delta.normalize(-180);
+	return from + delta * t;
+}
+
+void Actor::draw(float interpolation) {
+	Math::Vector3d pos = _pos;
+	Math::Angle pitch = _pitch, yaw = _yaw, roll = _roll;
+	if (interpolation < 1.f) {
+		pos = _prevPos + (_pos - _prevPos) * interpolation;
+		pitch = interpolateAngle(_prevPitch, _pitch, interpolation);
+		yaw = interpolateAngle(_prevYaw, _yaw, interpolation);
+		roll = interpolateAngle(_prevRoll, _roll, interpolation);
+	}
+
 	for (Common::List<Costume *>::iterator i = _costumeStack.begin(); i != _costumeStack.end(); ++i) {
 		Costume *c = *i;
 		c->setupTextures();
@@ -1174,23 +1201,38 @@ void Actor::draw() {
 
 	if (!_costumeStack.empty()) {
 		Costume *costume = _costumeStack.back();
+		// the bounds of the nodes are computed from it, the actor may
+		// have moved since its update
+		costume->setPosRotate(pos, pitch, yaw, roll);
+		Shadow *shadows[5];
+		int numShadows = 0;
 		for (int l = 0; l < 5; l++) {
-			if (!shouldDrawShadow(l))
-				continue;
-			g_driver->setShadow(&_shadowArray[l]);
-			g_driver->setShadowMode();
-			if (g_driver->isHardwareAccelerated())
-				g_driver->drawShadowPlanes();
-			g_driver->startActorDraw(_pos, _scale, _yaw, _pitch, _roll);
-			costume->draw();
-			g_driver->finishActorDraw();
-			g_driver->clearShadowMode();
-			g_driver->setShadow(NULL);
+			if (shouldDrawShadow(l))
+				shadows[numShadows++] = &_shadowArray[l];
+		}
+		// Only the meshes are projected along with the actor. A costume with
+		// sprites keeps a pass per shadow, so it shadows just as it always did.
+		bool shadowsWithActor = numShadows > 0 && !costume->hasSprites() &&
+								g_driver->setActorShadows(shadows, numShadows);
+		if (!shadowsWithActor) {
+			for (int l = 0; l < numShadows; l++) {
+				g_driver->setShadow(shadows[l]);
+				g_driver->setShadowMode();
+				if (g_driver->isHardwareAccelerated())
+					g_driver->drawShadowPlanes();
+				g_driver->startActorDraw(pos, _scale, yaw, pitch, roll);
+				costume->draw();
+				g_driver->finishActorDraw();
+				g_driver->clearShadowMode();
+				g_driver->setShadow(NULL);
+			}
 		}
 		// normal draw actor
-		g_driver->startActorDraw(_pos, _scale, _yaw, _pitch, _roll);
+		g_driver->startActorDraw(pos, _scale, yaw, pitch, roll);
 		costume->draw();
 		g_driver->finishActorDraw();
+		if (shadowsWithActor)
+			g_driver->setActorShadows(NULL, 0);
 	}
 
 	if (_mustPlaceText) {
@@ -1198,9 +1240,14 @@ void Actor::draw() {
 		x1 = y1 = 1000;
 		x2 = y2 = -1000;
 		if (!_costumeStack.empty()) {
-			g_driver->startActorDraw(_pos, _scale, _yaw, _pitch, _roll);
-			_costumeStack.back()->getBoundingBox(&x1, &y1, &x2, &y2);
-			g_driver->finishActorDraw();
+			Costume *costume = _costumeStack.back();
+			// the scale applies to the whole model
+			Math::Matrix4 matrix = costume->getMatrix();
+			for (int i = 0; i < 3; i++) {
+				for (int j = 0; j < 3; j++)
+					matrix.setValue(i, j, matrix.getValue(i, j) * _scale);
+			}
+			costume->getBoundingBox(matrix, &x1, &y1, &x2, &y2);
 		}
 
 		TextObject *textObject = TextObject::getPool().getObject(_sayLineText);
@@ -424,7 +424,21 @@ public:
 		_constrain = constrain;
 	}
 	void update(uint frameTime);
-	void draw();
+	/**
+	 * Keeps the current position and rotation, the actor is drawn between
+	 * them and the ones the next update gives.
+	 *
+	 * @see draw
+	 */
+	void saveDrawTransform();
+	/**
+	 * Draws the actor.
+	 *
+	 * @param interpolation How far the actor is drawn from the transform
+	 *                      kept by saveDrawTransform(), 0 to draw it there
+	 *                      and 1 to draw it at its current one.
+	 */
+	void draw(float interpolation = 1.f);
 	void undraw(bool);
 
 	bool isLookAtVectorZero() {
@@ -476,6 +490,9 @@ private:
 	PoolColor *_talkColor;
 	Math::Vector3d _pos;
 	Math::Angle _pitch, _yaw, _roll;
+	// the transform kept by saveDrawTransform()
+	Math::Vector3d _prevPos;
+	Math::Angle _prevPitch, _prevYaw, _prevRoll;
 	float _walkRate, _turnRate;
 
 	bool _constrain;	// Constrain to walkboxes
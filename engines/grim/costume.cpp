@@ -113,7 +113,7 @@ Costume::Costume(const Common::String &fname, Common::SeekableReadStream *data,
 	if (g_grim->getGameType() == GType_MONKEY4) {
 		loadEMI(data, prevCost);
 	} else {
-		TextSplitter ts(data);
+		TextSplitter ts(_fname, data);
 		loadGRIM(ts, prevCost);
 	}
 	delete data;
@@ -145,7 +145,7 @@ void Costume::loadGRIM(TextSplitter &ts, Costume *prevCost) {
 		const char *line = ts.getCurrentLine();
 		Component *prevComponent = NULL;
 
-		if (sscanf(line, " %d %d %d %d %n", &id, &tagID, &hash, &parentID, &namePos) < 4)
+		if (ts.scanCurrentLine(0, " %d %d %d %d %n", &id, &tagID, &hash, &parentID, &namePos) < 4)
 			error("Bad component specification line: `%s'", line);
 		ts.nextLine();
 
@@ -545,15 +545,24 @@ void Costume::draw() {
 			_components[i]->draw();
 }
 
-void Costume::getBoundingBox(int *x1, int *y1, int *x2, int *y2) {
+// The matrix places the costume in the world
+void Costume::getBoundingBox(const Math::Matrix4 &matrix, int *x1, int *y1, int *x2, int *y2) {
 	for (int i = 0; i < _numComponents; i++) {
 		ModelComponent *c = dynamic_cast<ModelComponent *>(_components[i]);
 		if (c) {
-			c->getBoundingBox(x1, y1, x2, y2);
+			c->getBoundingBox(matrix, x1, y1, x2, y2);
 		}
 	}
 }
 
+bool Costume::hasSprites() const {
+	for (int i = 0; i < _numComponents; i++) {
+		if (dynamic_cast<SpriteComponent *>(_components[i]))
+			return true;
+	}
+	return false;
+}
+
 int Costume::update(uint time) {
 	for (Common::List<Chore*>::iterator i = _playingChores.begin(); i != _playingChores.end(); ++i) {
 		(*i)->update(time);
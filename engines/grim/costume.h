@@ -81,7 +81,8 @@ public:
 	void animate();
 	void setupTextures();
 	void draw();
-	void getBoundingBox(int *x1, int *y1, int *x2, int *y2);
+	void getBoundingBox(const Math::Matrix4 &matrix, int *x1, int *y1, int *x2, int *y2);
+	bool hasSprites() const;
 	void setPosRotate(Math::Vector3d pos, const Math::Angle &pitch,
 					  const Math::Angle &yaw, const Math::Angle &roll);
 	Math::Matrix4 getMatrix() const;
@@ -28,6 +28,7 @@
 #include "engines/grim/gfx_base.h"
 #include "engines/grim/colormap.h"
 #include "engines/grim/animation.h"
+#include "engines/grim/costume.h"
 
 #include "engines/grim/costume/model_component.h"
 #include "engines/grim/costume/main_model_component.h"
@@ -180,6 +181,12 @@ void ModelComponent::draw() {
 
 	if (_parent && _parent->isVisible())
 			return;
+
+	// bring the bounds of the nodes up to date, so that the renderer
+	// can skip what doesn't show
+	if (g_driver->isCulling())
+		_hier->updateBounds(getHierarchyMatrix(_cost->getMatrix()));
+
 	// Need to translate object to be in accordance
 	// with the setup of the parent
 	translateObject(false);
@@ -190,20 +197,29 @@ void ModelComponent::draw() {
 	translateObject(true);
 }
 
-void ModelComponent::getBoundingBox(int *x1, int *y1, int *x2, int *y2) {
+void ModelComponent::getBoundingBox(const Math::Matrix4 &matrix, int *x1, int *y1, int *x2, int *y2) {
 	// If the object was drawn by being a component
 	// of it's parent then don't draw it
 
 	if (_parent && _parent->isVisible())
 		return;
-	// Need to translate object to be in accordance
-		// with the setup of the parent
-	translateObject(false);
 
-	_hier->getBoundingBox(x1, y1, x2, y2);
+	_hier->getBoundingBox(getHierarchyMatrix(matrix), x1, y1, x2, y2);
+}
+
+// The matrix the hierarchy hangs from, that of the nodes of the parent
+// model when there is one
+Math::Matrix4 ModelComponent::getHierarchyMatrix(const Math::Matrix4 &matrix) {
+	if (_hier->_parent)
+		return getNodeMatrix(_hier->_parent, matrix);
+	return matrix;
+}
 
-	// Need to un-translate when done
-	translateObject(true);
+Math::Matrix4 ModelComponent::getNodeMatrix(ModelNode *node, const Math::Matrix4 &matrix) {
+	Math::Matrix4 parentMatrix = matrix;
+	if (node->_parent)
+		parentMatrix = getNodeMatrix(node->_parent, matrix);
+	return parentMatrix * node->getLocalMatrix();
 }
 
 } // end of namespace Grim
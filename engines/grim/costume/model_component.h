@@ -44,13 +44,15 @@ public:
 	void restoreState(SaveGame *state);
 	void translateObject(bool reset);
 	static void translateObject(ModelNode *node, bool reset);
+	Math::Matrix4 getHierarchyMatrix(const Math::Matrix4 &matrix);
+	static Math::Matrix4 getNodeMatrix(ModelNode *node, const Math::Matrix4 &matrix);
 	AnimManager *getAnimManager() const;
 
 	ModelNode *getHierarchy() { return _hier; }
 	int getNumNodes();
 	Model *getModel() { return _obj; }
 	void draw();
-	void getBoundingBox(int *x1, int *y1, int *x2, int *y2);
+	void getBoundingBox(const Math::Matrix4 &matrix, int *x1, int *y1, int *x2, int *y2);
 
 protected:
 	Common::String _filename;
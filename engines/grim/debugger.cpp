@@ -0,0 +1,206 @@
+/* ResidualVM - A 3D game interpreter
+ *
+ * ResidualVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ *
+ */
+
+
+#include "common/file.h"
+#include "common/fs.h"
+#include "common/hashmap.h"
+#include "common/hash-str.h"
+
+#include "engines/grim/debugger.h"
+#include "engines/grim/resource.h"
+
+namespace Grim {
+
+struct ResourceTypeStats {
+	uint32 loads, hits, misses, bytes, readTime, parseTime;
+};
+
+Debugger::Debugger() : GUI::Debugger() {
+	DCmd_Register("resprofile", WRAP_METHOD(Debugger, Cmd_ResProfile));
+	DCmd_Register("resstats", WRAP_METHOD(Debugger, Cmd_ResStats));
+	DCmd_Register("resdump", WRAP_METHOD(Debugger, Cmd_ResDump));
+	DCmd_Register("restrace", WRAP_METHOD(Debugger, Cmd_ResTrace));
+	DCmd_Register("labpack", WRAP_METHOD(Debugger, Cmd_LabPack));
+}
+
+Debugger::~Debugger() {
+}
+
+bool Debugger::Cmd_ResProfile(int argc, const char **argv) {
+	if (argc == 2 && !strcmp(argv[1], "on")) {
+		g_resourceloader->setProfiling(true);
+	} else if (argc == 2 && !strcmp(argv[1], "off")) {
+		g_resourceloader->setProfiling(false);
+	} else if (argc == 2 && !strcmp(argv[1], "clear")) {
+		g_resourceloader->clearLoadRecords();
+	} else if (argc != 1) {
+		DebugPrintf("Usage: %s [on|off|clear]\n", argv[0]);
+		return true;
+	}
+
+	DebugPrintf("Resource profiling is %s, %d loads recorded\n", g_resourceloader->isProfiling() ? "on" : "off",
+				g_resourceloader->getLoadRecords().size());
+	return true;
+}
+
+bool Debugger::Cmd_ResStats(int argc, const char **argv) {
+	uint count = 10;
+	if (argc > 2) {
+		DebugPrintf("Usage: %s [count of the slowest loads]\n", argv[0]);
+		return true;
+	} else if (argc == 2) {
+		count = atoi(argv[1]);
+	}
+
+	typedef Common::HashMap<Common::String, ResourceTypeStats> TypeStatsMap;
+	TypeStatsMap stats;
+
+	const ResourceLoader::LoadRecordList &records = g_resourceloader->getLoadRecords();
+	Common::Array<const ResourceLoader::LoadRecord *> slowest;
+	for (ResourceLoader::LoadRecordList::const_iterator i = records.begin(); i != records.end(); ++i) {
+		if (!stats.contains(i->type)) {
+			ResourceTypeStats empty = { 0, 0, 0, 0, 0, 0 };
+			stats[i->type] = empty;
+		}
+		ResourceTypeStats &s = stats[i->type];
+		s.loads++;
+		if (i->cacheUse == ResourceLoader::kCacheHit)
+			s.hits++;
+		else if (i->cacheUse == ResourceLoader::kCacheMiss)
+			s.misses++;
+		s.bytes += i->bytes;
+		s.readTime += i->readTime;
+		s.parseTime += i->parseTime;
+
+		// Keep the slowest loads, sorted by their total time
+		uint pos = slowest.size();
+		while (pos > 0 && slowest[pos - 1]->totalTime < i->totalTime)
+			pos--;
+		if (pos < count) {
+			slowest.insert_at(pos, &*i);
+			if (slowest.size() > count)
+				slowest.pop_back();
+		}
+	}
+
+	DebugPrintf("%-10s %6s %6s %6s %10s %9s %9s\n", "type", "loads", "hits", "misses", "bytes", "read ms", "parse ms");
+	for (TypeStatsMap::const_iterator i = stats.begin(); i != stats.end(); ++i) {
+		const ResourceTypeStats &s = i->_value;
+		DebugPrintf("%-10s %6d %6d %6d %10d %9.3f %9.3f\n", i->_key.c_str(), s.loads, s.hits, s.misses, s.bytes,
+					s.readTime / 1000.f, s.parseTime / 1000.f);
+	}
+	DebugPrintf("Resource cache: %d hits, %d misses, %d evictions, %d bytes\n", g_resourceloader->getCacheHits(),
+				g_resourceloader->getCacheMisses(), g_resourceloader->getCacheEvictions(),
+				g_resourceloader->getCacheMemorySize());
+
+	if (!slowest.empty()) {
+		DebugPrintf("\nSlowest loads:\n");
+		for (uint j = 0; j < slowest.size(); j++) {
+			const ResourceLoader::LoadRecord *r = slowest[j];
+			DebugPrintf("%9.3f ms  %-10s %-24s from %s\n", r->totalTime / 1000.f, r->type.c_str(), r->name.c_str(),
+						r->caller.c_str());
+		}
+	}
+	return true;
+}
+
+bool Debugger::Cmd_ResDump(int argc, const char **argv) {
+	if (argc > 2) {
+		DebugPrintf("Usage: %s [file]\n", argv[0]);
+		return true;
+	}
+
+	const char *filename = argc == 2 ? argv[1] : "resources.csv";
+	if (g_resourceloader->dumpLoadRecords(filename))
+		DebugPrintf("Dumped %d loads to %s\n", g_resourceloader->getLoadRecords().size(), filename);
+	else
+		DebugPrintf("Could not write %s\n", filename);
+	return true;
+}
+
+bool Debugger::Cmd_ResTrace(int argc, const char **argv) {
+	if (argc == 3 && !strcmp(argv[1], "save")) {
+		Common::DumpFile out;
+		if (!out.open(argv[2])) {
+			DebugPrintf("Could not write %s\n", argv[2]);
+			return true;
+		}
+		const Common::StringArray &trace = g_resourceloader->getAccessTrace();
+		for (Common::StringArray::const_iterator i = trace.begin(); i != trace.end(); ++i)
+			out.writeString(*i + "\n");
+		out.finalize();
+	} else if (argc == 2 && !strcmp(argv[1], "on")) {
+		g_resourceloader->setTracing(true);
+	} else if (argc == 2 && !strcmp(argv[1], "off")) {
+		g_resourceloader->setTracing(false);
+	} else if (argc == 2 && !strcmp(argv[1], "clear")) {
+		g_resourceloader->clearAccessTrace();
+	} else if (argc != 1) {
+		DebugPrintf("Usage: %s [on|off|clear|save <file>]\n", argv[0]);
+		return true;
+	}
+
+	DebugPrintf("Access tracing is %s, %d files traced\n", g_resourceloader->isTracing() ? "on" : "off",
+				g_resourceloader->getAccessTrace().size());
+	return true;
+}
+
+bool Debugger::Cmd_LabPack(int argc, const char **argv) {
+	if (argc < 2 || argc > 3) {
+		DebugPrintf("Usage: %s <output file> [trace file]\n", argv[0]);
+		DebugPrintf("Packs the traced files in the order they were read, then move the output\n");
+		DebugPrintf("into the game directory as %s\n", ResourceLoader::getPackedArchiveName().c_str());
+		return true;
+	}
+
+	// The trace saved by "restrace save", or the one of this session
+	Common::StringArray members;
+	if (argc == 3) {
+		Common::File in;
+		if (!in.open(Common::FSNode(argv[2]))) {
+			DebugPrintf("Could not read %s\n", argv[2]);
+			return true;
+		}
+		while (!in.eos() && !in.err()) {
+			Common::String line = in.readLine();
+			line.trim();
+			if (!line.empty())
+				members.push_back(line);
+		}
+	} else {
+		members = g_resourceloader->getAccessTrace();
+	}
+
+	if (members.empty()) {
+		DebugPrintf("The trace is empty, enable it with \"restrace on\"\n");
+		return true;
+	}
+
+	if (g_resourceloader->writePackedArchive(argv[1], members))
+		DebugPrintf("Packed %d files into %s\n", members.size(), argv[1]);
+	else
+		DebugPrintf("Could not write %s\n", argv[1]);
+	return true;
+}
+
+} // end of namespace Grim
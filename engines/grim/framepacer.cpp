@@ -0,0 +1,119 @@
+/* ResidualVM - A 3D game interpreter
+ *
+ * ResidualVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ *
+ */
+
+#include "common/config-manager.h"
+#include "common/system.h"
+
+#include "engines/grim/framepacer.h"
+
+namespace Grim {
+
+FramePacer::FramePacer() :
+		_tickUs(0), _frameStart(0), _lastTime(0), _accumulator(0), _tickCount(0), _deadline(0) {
+	int rate = ConfMan.getInt("simulation_rate");
+	if (rate > 0)
+		_tickUs = 1000000 / rate;
+	_interpolate = _tickUs && ConfMan.getBool("interpolate_actors");
+
+	reset();
+}
+
+uint64 FramePacer::getMicros() {
+	return (uint64)g_system->getMillis() * 1000;
+}
+
+void FramePacer::reset() {
+	_lastTime = _deadline = getMicros();
+	_accumulator = 0;
+}
+
+int FramePacer::beginFrame() {
+	_frameStart = g_system->getMillis();
+	if (!_tickUs)
+		return 0;
+
+	uint64 now = getMicros();
+	_accumulator += now - _lastTime;
+	_lastTime = now;
+
+	uint64 ticks = _accumulator / _tickUs;
+	if (ticks > kMaxTicksPerFrame) {
+		ticks = kMaxTicksPerFrame;
+		_accumulator %= _tickUs;
+	} else {
+		_accumulator -= ticks * _tickUs;
+	}
+	return (int)ticks;
+}
+
+uint32 FramePacer::nextTick() {
+	// the ticks are whole milliseconds, spread so that they add up to
+	// the exact rate
+	uint64 start = (uint64)_tickCount * _tickUs / 1000;
+	_tickCount++;
+	return (uint32)((uint64)_tickCount * _tickUs / 1000 - start);
+}
+
+float FramePacer::getInterpolation() const {
+	if (!_interpolate)
+		return 1.f;
+	return (float)_accumulator / _tickUs;
+}
+
+void FramePacer::waitForFrameEnd(uint32 frameMs) {
+	if (!_tickUs) {
+		uint32 endTime = g_system->getMillis();
+		if (frameMs == 0 || _frameStart > endTime)
+			return;
+		uint32 diffTime = endTime - _frameStart;
+		if (diffTime < frameMs)
+			g_system->delayMillis(frameMs - diffTime);
+		return;
+	}
+
+	uint64 now = getMicros();
+	if (frameMs == 0) {
+		_deadline = now;
+		return;
+	}
+
+	// the deadlines follow each other, so a late frame is made up for by
+	// the next one and the rate holds on average
+	uint64 frameUs = (uint64)frameMs * 1000;
+	_deadline += frameUs;
+	if (now >= _deadline) {
+		// too far behind to catch up, start over from now
+		if (now - _deadline > frameUs)
+			_deadline = now;
+		return;
+	}
+
+	// delayMillis() may oversleep by about a millisecond, so sleep until
+	// one or two are left and only spin out the rest
+	uint64 remaining = _deadline - now;
+	if (remaining > 2000)
+		g_system->delayMillis((uint)(remaining / 1000) - 1);
+	while (getMicros() < _deadline)
+		;
+}
+
+} // end of namespace Grim
@@ -0,0 +1,98 @@
+/* ResidualVM - A 3D game interpreter
+ *
+ * ResidualVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ *
+ */
+
+#ifndef GRIM_FRAMEPACER_H
+#define GRIM_FRAMEPACER_H
+
+#include "common/scummsys.h"
+
+namespace Grim {
+
+/**
+ * Paces the frames of the main loop.
+ *
+ * By default the game is updated once per frame, by the time the frame
+ * took. With a simulation rate set, the game is instead updated in ticks of
+ * a fixed length, as many as the elapsed time holds, and the frames are
+ * drawn as often as the engine speed allows. The actors can then be drawn
+ * between their last two ticks, so they move smoothly when the frames
+ * outnumber the ticks.
+ */
+class FramePacer {
+public:
+	FramePacer();
+
+	/** Whether the game is updated in fixed ticks */
+	bool isFixedStep() const { return _tickUs != 0; }
+
+	/** Drops the time not simulated yet, the next frame starts now */
+	void reset();
+
+	/**
+	 * Adds the time elapsed since the previous frame.
+	 *
+	 * @return The number of ticks to run in this frame.
+	 */
+	int beginFrame();
+	/** Returns the length of the next tick, in milliseconds */
+	uint32 nextTick();
+	/**
+	 * Returns how far the frame is from the tick before the last one to
+	 * the last one, 1 when the actors aren't interpolated.
+	 */
+	float getInterpolation() const;
+
+	/**
+	 * Waits for the frame to have lasted frameMs since beginFrame().
+	 * Nothing is waited for when frameMs is 0.
+	 *
+	 * In fixed step mode the frames end at a steady deadline instead, so a
+	 * late frame is made up for by the next one. The wait sleeps until a
+	 * millisecond or two is left, and only spins for the rest.
+	 */
+	void waitForFrameEnd(uint32 frameMs);
+
+	/**
+	 * Returns the time in microseconds, on the scale of OSystem::getMillis()
+	 * and with its precision.
+	 */
+	static uint64 getMicros();
+
+private:
+	enum {
+		// beyond that the game slows down instead of running ticks
+		// ever longer to catch up
+		kMaxTicksPerFrame = 5
+	};
+
+	uint32 _tickUs;
+	bool _interpolate;
+	uint32 _frameStart;
+	uint64 _lastTime;
+	uint64 _accumulator;
+	uint32 _tickCount;
+	uint64 _deadline;
+};
+
+} // end of namespace Grim
+
+#endif
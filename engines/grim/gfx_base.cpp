@@ -23,6 +23,7 @@
 #include "engines/grim/gfx_base.h"
 #include "engines/grim/savegame.h"
 #include "engines/grim/colormap.h"
+#include "engines/grim/model.h"
 
 namespace Grim {
 
@@ -45,6 +46,11 @@ bool GfxBase::isShadowModeActive() {
 	return _shadowModeActive;
 }
 
+void GfxBase::drawMesh(const Mesh *mesh) {
+	for (int i = 0; i < mesh->_numFaces; i++)
+		mesh->_faces[i].draw(mesh->_vertices, mesh->_vertNormals, mesh->_textureVerts);
+}
+
 void GfxBase::saveState(SaveGame *state) {
 	state->beginSection('DRVR');
 
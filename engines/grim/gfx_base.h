@@ -90,11 +90,46 @@ public:
 	 */
 	virtual void flipBuffer() = 0;
 
-	virtual void getBoundingBoxPos(const Mesh *mesh, int *x1, int *y1, int *x2, int *y2) = 0;
+	/**
+	 * Projects points in world coordinates to the screen, with the camera
+	 * alone, and gets the rectangle enclosing them in the game's screen
+	 * coordinates. The rectangle is -1 when off the screen.
+	 *
+	 * @param points	the points to project
+	 * @param count		the number of points
+	 */
+	virtual void getBoundingBoxPos(const Math::Vector3d *points, int count, int *x1, int *y1, int *x2, int *y2) = 0;
 	virtual void startActorDraw(Math::Vector3d pos, float scale, const Math::Angle &yaw,
 								const Math::Angle &pitch, const Math::Angle &roll) = 0;
 	virtual void finishActorDraw() = 0;
 	virtual void setShadow(Shadow *shadow) = 0;
+
+	/**
+	 * Sets the shadows to draw along with the next actor, in the same pass
+	 * as the actor: every mesh is projected into the shadows right before
+	 * it is drawn, sprites are left out. Renderers that can't do it return
+	 * false, the actor then needs a pass of its own for every shadow.
+	 *
+	 * @param shadows	the shadows, NULL once the actor is drawn
+	 * @param count		the number of shadows
+	 */
+	virtual bool setActorShadows(Shadow **shadows, int count) { return false; }
+
+	/**
+	 * Tells whether anything inside a sphere may show in the current actor
+	 * draw. Renderers return false when the sphere is out of the view or
+	 * hidden behind the z bitmaps; true is always a safe answer.
+	 *
+	 * @param center	the center of the sphere, in world coordinates
+	 * @param radius	the radius of the sphere
+	 */
+	virtual bool isSphereVisible(const Math::Vector3d &center, float radius) { return true; }
+	/**
+	 * Tells whether isSphereVisible() ever answers false, that is whether
+	 * the bounds of the model nodes are worth computing.
+	 */
+	virtual bool isCulling() const { return false; }
+
 	virtual void drawShadowPlanes() = 0;
 	virtual void setShadowMode();
 	virtual void clearShadowMode();
@@ -113,6 +148,33 @@ public:
 	virtual void drawModelFace(const MeshFace *face, float *vertices, float *vertNormals, float *textureVerts) = 0;
 	virtual void drawSprite(const Sprite *sprite) = 0;
 
+	/**
+	 * Prepares a loaded mesh for drawMesh, the renderer may keep its own
+	 * representation of the geometry in the mesh user data.
+	 *
+	 * @param mesh	the mesh to be prepared
+	 * @see drawMesh
+	 * @see destroyMesh
+	 */
+	virtual void createMesh(Mesh *mesh) { }
+
+	/**
+	 * Draws all the faces of a mesh with their materials. By default
+	 * this draws them one by one with drawModelFace.
+	 *
+	 * @param mesh	the mesh to be drawn
+	 * @see createMesh
+	 */
+	virtual void drawMesh(const Mesh *mesh);
+
+	/**
+	 * Deletes the representation of a mesh created by createMesh.
+	 *
+	 * @param mesh	the mesh to be destroyed
+	 * @see createMesh
+	 */
+	virtual void destroyMesh(Mesh *mesh) { }
+
 	virtual void enableLights() = 0;
 	virtual void disableLights() = 0;
 	virtual void setupLight(Light *light, int lightId) = 0;
@@ -158,6 +220,32 @@ public:
 	 */
 	virtual void destroyBitmap(BitmapData *bitmap) = 0;
 
+	/**
+	 * Restores a background stored with storeBackground, the color and
+	 * the depth of the screen as they were when it was stored.
+	 * Renderers that don't keep backgrounds always fail.
+	 *
+	 * @param key		what the background belongs to, e.g. a camera setup
+	 * @param version	only a background stored with this version is restored
+	 * @return true if the screen now holds the background
+	 * @see storeBackground
+	 */
+	virtual bool restoreBackground(const void *key, uint version) { return false; }
+
+	/**
+	 * Stores what was drawn on the screen so far as the background of key,
+	 * replacing the one stored before.
+	 *
+	 * @see restoreBackground
+	 * @see forgetBackground
+	 */
+	virtual void storeBackground(const void *key, uint version) { }
+
+	/**
+	 * Drops the background stored for key, after this the key may be reused.
+	 */
+	virtual void forgetBackground(const void *key) { }
+
 	virtual void createFont(Font *font) = 0;
 	virtual void destroyFont(Font *font) = 0;
 
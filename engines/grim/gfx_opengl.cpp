@@ -250,7 +250,7 @@ static void glShadowProjection(Math::Vector3d light, Math::Vector3d plane, Math:
 	glMultMatrixf((GLfloat *)mat);
 }
 
-void GfxOpenGL::getBoundingBoxPos(const Mesh *model, int *x1, int *y1, int *x2, int *y2) {
+void GfxOpenGL::getBoundingBoxPos(const Math::Vector3d *points, int count, int *x1, int *y1, int *x2, int *y2) {
 	if (_currentShadowArray) {
 		*x1 = -1;
 		*y1 = -1;
@@ -265,33 +265,26 @@ void GfxOpenGL::getBoundingBoxPos(const Mesh *model, int *x1, int *y1, int *x2,
 	GLdouble bottom = -1000;
 	GLdouble winX, winY, winZ;
 
-	for (int i = 0; i < model->_numFaces; i++) {
-		Math::Vector3d v;
-		float* pVertices;
+	GLdouble modelView[16], projection[16];
+	GLint viewPort[4];
 
-		for (int j = 0; j < model->_faces[i]._numVertices; j++) {
-			GLdouble modelView[16], projection[16];
-			GLint viewPort[4];
+	glGetDoublev(GL_MODELVIEW_MATRIX, modelView);
+	glGetDoublev(GL_PROJECTION_MATRIX, projection);
+	glGetIntegerv(GL_VIEWPORT, viewPort);
 
-			glGetDoublev(GL_MODELVIEW_MATRIX, modelView);
-			glGetDoublev(GL_PROJECTION_MATRIX, projection);
-			glGetIntegerv(GL_VIEWPORT, viewPort);
+	for (int i = 0; i < count; i++) {
+		const Math::Vector3d &v = points[i];
 
-			pVertices = model->_vertices + 3 * model->_faces[i]._vertices[j];
+		gluProject(v.x(), v.y(), v.z(), modelView, projection, viewPort, &winX, &winY, &winZ);
 
-			v.set(*(pVertices), *(pVertices + 1), *(pVertices + 2));
-
-			gluProject(v.x(), v.y(), v.z(), modelView, projection, viewPort, &winX, &winY, &winZ);
-
-			if (winX > right)
-				right = winX;
-			if (winX < left)
-				left = winX;
-			if (winY < top)
-				top = winY;
-			if (winY > bottom)
-				bottom = winY;
-		}
+		if (winX > right)
+			right = winX;
+		if (winX < left)
+			left = winX;
+		if (winY < top)
+			top = winY;
+		if (winY > bottom)
+			bottom = winY;
 	}
 
 	double t = bottom;
@@ -59,7 +59,7 @@ public:
 
 	bool isHardwareAccelerated();
 
-	void getBoundingBoxPos(const Mesh *model, int *x1, int *y1, int *x2, int *y2);
+	void getBoundingBoxPos(const Math::Vector3d *points, int count, int *x1, int *y1, int *x2, int *y2);
 
 	void startActorDraw(Math::Vector3d pos, float scale, const Math::Angle &yaw,
 						const Math::Angle &pitch, const Math::Angle &roll);
@@ -22,6 +22,8 @@
 
 #include "common/endian.h"
 #include "common/system.h"
+#include "common/config-manager.h"
+#include "common/hashmap.h"
 
 #include "graphics/surface.h"
 
@@ -148,9 +150,16 @@ GfxTinyGL::GfxTinyGL() {
 	g_driver = this;
 	_zb = NULL;
 	_storedDisplay = NULL;
+	_gameWidth = _gameHeight = 0;
+	_screenChangeID = -1;
+	_fullRedraw = true;
+	_cullActor = false;
+	_depthTilesValid = false;
 }
 
 GfxTinyGL::~GfxTinyGL() {
+	for (uint i = 0; i < _backgrounds.size(); i++)
+		freeBackground(_backgrounds[i]);
 	delete[] _storedDisplay;
 	if (_zb) {
 		TinyGL::glClose();
@@ -159,10 +168,28 @@ GfxTinyGL::~GfxTinyGL() {
 }
 
 byte *GfxTinyGL::setupScreen(int screenW, int screenH, bool fullscreen) {
-	byte *buffer = g_system->setupScreen(screenW, screenH, fullscreen, false);
+	// The 3D scene is rendered at the size of the window, which can be set
+	// apart from the game's screen; the 2D elements get scaled to match.
+	int renderW = screenW;
+	int renderH = screenH;
+	if (ConfMan.hasKey("tinygl_width") && ConfMan.hasKey("tinygl_height")) {
+		// TinyGL wants the width to be a multiple of 4
+		renderW = ConfMan.getInt("tinygl_width") & ~3;
+		renderH = ConfMan.getInt("tinygl_height");
+		if (renderW <= 0 || renderH <= 0) {
+			warning("Invalid TinyGL resolution %dx%d, using %dx%d", renderW, renderH, screenW, screenH);
+			renderW = screenW;
+			renderH = screenH;
+		}
+	}
 
-	_screenWidth = screenW;
-	_screenHeight = screenH;
+	byte *buffer = g_system->setupScreen(renderW, renderH, fullscreen, false);
+	_screenChangeID = g_system->getScreenChangeID();
+
+	_gameWidth = screenW;
+	_gameHeight = screenH;
+	_screenWidth = renderW;
+	_screenHeight = renderH;
 	_screenBPP = 15;
 	_isFullscreen = g_system->getFeatureState(OSystem::kFeatureFullscreenMode);
 
@@ -170,14 +197,33 @@ byte *GfxTinyGL::setupScreen(int screenW, int screenH, bool fullscreen) {
 
 	g_system->setWindowCaption("ResidualVM: Software 3D Renderer");
 
-	_zb = TinyGL::ZB_open(screenW, screenH, ZB_MODE_5R6G5B, buffer);
-	TinyGL::glInit(_zb);
+	if (_zb) {
+		// the surface may have moved, keep the zbuffer on top of it
+		TinyGL::ZB_resize(_zb, buffer, renderW, renderH);
+		tglViewport(0, 0, renderW, renderH);
+	} else {
+		_zb = TinyGL::ZB_open(renderW, renderH, ZB_MODE_5R6G5B, buffer);
+		TinyGL::glInit(_zb);
 
-	_storedDisplay = new byte[640 * 480 * 2];
-	memset(_storedDisplay, 0, 640 * 480 * 2);
+		tglSetRasterThreads(ConfMan.getInt("tinygl_threads"));
+	}
+
+	delete[] _storedDisplay;
+	_storedDisplay = new byte[_screenWidth * _screenHeight * 2];
+	memset(_storedDisplay, 0, _screenWidth * _screenHeight * 2);
 
 	_currentShadowArray = NULL;
 
+	// the stored backgrounds and the regions of the last frame don't mean
+	// anything on the new screen
+	for (uint i = 0; i < _backgrounds.size(); i++)
+		freeBackground(_backgrounds[i]);
+	_backgrounds.clear();
+	_drawnRects.clear();
+	_prevDrawnRects.clear();
+	_primitivesRect = Common::Rect();
+	_fullRedraw = true;
+
 	TGLfloat ambientSource[] = { 0.0f, 0.0f, 0.0f, 1.0f };
 	tglLightModelfv(TGL_LIGHT_MODEL_AMBIENT, ambientSource);
 
@@ -211,24 +257,129 @@ void GfxTinyGL::positionCamera(Math::Vector3d pos, Math::Vector3d interest) {
 }
 
 void GfxTinyGL::clearScreen() {
-	memset(_zb->pbuf, 0, 640 * 480 * 2);
-	memset(_zb->zbuf, 0, 640 * 480 * 2);
-	memset(_zb->zbuf2, 0, 640 * 480 * 4);
+	tglFlush();
+	memset(_zb->pbuf, 0, _screenWidth * _screenHeight * 2);
+	memset(_zb->zbuf, 0, _screenWidth * _screenHeight * 2);
+	memset(_zb->zbuf2, 0, _screenWidth * _screenHeight * 4);
+	_depthTilesValid = false;
 }
 
 void GfxTinyGL::flipBuffer() {
-	g_system->updateScreen();
+	tglFlush();
+	presentFrame();
+
+	// something else set up a new video mode, the frame buffer is gone
+	if (g_system->getScreenChangeID() != _screenChangeID)
+		setupScreen(_gameWidth, _gameHeight, _isFullscreen);
+}
+
+Common::Rect GfxTinyGL::toScreenRect(int x, int y, int width, int height) const {
+	return Common::Rect(toScreenX(x), toScreenY(y), toScreenX(x + width), toScreenY(y + height));
+}
+
+void GfxTinyGL::addDrawnRect(const void *data, const Common::Rect &rect) {
+	if (data) {
+		// frames that are not flipped draw the same things again
+		for (uint i = 0; i < _drawnRects.size(); i++) {
+			if (_drawnRects[i].data == data && _drawnRects[i].rect == rect)
+				return;
+		}
+	}
+
+	DrawnRect drawn;
+	drawn.data = data;
+	drawn.rect = rect;
+	_drawnRects.push_back(drawn);
+}
+
+void GfxTinyGL::addDrawnTriangles() {
+	// the bounding box of the triangles TinyGL filled since the last call
+	if (_zb->dirty_xmin <= _zb->dirty_xmax && _zb->dirty_ymin <= _zb->dirty_ymax) {
+		addDrawnRect(NULL, Common::Rect(_zb->dirty_xmin, _zb->dirty_ymin, _zb->dirty_xmax + 1, _zb->dirty_ymax + 1));
+	}
+	TinyGL::ZB_resetDirty(_zb);
+}
+
+void GfxTinyGL::addDirtyRect(Common::Rect rect) {
+	rect.clip(_screenWidth, _screenHeight);
+	if (rect.isEmpty())
+		return;
+
+	// merge the overlapping rectangles, so no pixel is presented twice
+	for (uint i = 0; i < _dirtyRects.size();) {
+		if (_dirtyRects[i].intersects(rect)) {
+			rect.extend(_dirtyRects[i]);
+			_dirtyRects.remove_at(i);
+			i = 0;
+		} else {
+			i++;
+		}
+	}
+	_dirtyRects.push_back(rect);
+}
+
+void GfxTinyGL::forgetDrawnData(const void *data) {
+	// the memory may be reused for other pixels, don't match it anymore
+	for (uint i = 0; i < _drawnRects.size(); i++) {
+		if (_drawnRects[i].data == data)
+			_drawnRects[i].data = NULL;
+	}
+	for (uint i = 0; i < _prevDrawnRects.size(); i++) {
+		if (_prevDrawnRects[i].data == data)
+			_prevDrawnRects[i].data = NULL;
+	}
+}
+
+void GfxTinyGL::presentFrame() {
+	addDrawnTriangles();
+	if (!_primitivesRect.isEmpty()) {
+		addDrawnRect(NULL, _primitivesRect);
+		_primitivesRect = Common::Rect();
+	}
+
+	// the regions drawn in only one of the two frames, or with changing
+	// pixels, are damaged
+	_dirtyRects.clear();
+	for (uint i = 0; i < _drawnRects.size(); i++) {
+		const DrawnRect &drawn = _drawnRects[i];
+		bool same = false;
+		for (uint j = 0; drawn.data && j < _prevDrawnRects.size() && !same; j++)
+			same = _prevDrawnRects[j].data == drawn.data && _prevDrawnRects[j].rect == drawn.rect;
+		if (!same)
+			addDirtyRect(drawn.rect);
+	}
+	for (uint i = 0; i < _prevDrawnRects.size(); i++) {
+		const DrawnRect &drawn = _prevDrawnRects[i];
+		bool same = false;
+		for (uint j = 0; drawn.data && j < _drawnRects.size() && !same; j++)
+			same = _drawnRects[j].data == drawn.data && _drawnRects[j].rect == drawn.rect;
+		if (!same)
+			addDirtyRect(drawn.rect);
+	}
+
+	int dirtyArea = 0;
+	for (uint i = 0; i < _dirtyRects.size(); i++)
+		dirtyArea += _dirtyRects[i].width() * _dirtyRects[i].height();
+
+	// past half of the screen, one big copy beats many small ones
+	if (_fullRedraw || dirtyArea > _screenWidth * _screenHeight / 2)
+		g_system->updateScreen();
+	else if (!_dirtyRects.empty())
+		g_system->updateScreenRects(&_dirtyRects[0], _dirtyRects.size());
+
+	_prevDrawnRects = _drawnRects;
+	_drawnRects.clear();
+	_fullRedraw = false;
 }
 
 bool GfxTinyGL::isHardwareAccelerated() {
 	return false;
 }
 
-static void tglShadowProjection(Math::Vector3d light, Math::Vector3d plane, Math::Vector3d normal, bool dontNegate) {
+static void shadowProjection(float *mat, Math::Vector3d light, Math::Vector3d plane, Math::Vector3d normal, bool dontNegate) {
 	// Based on GPL shadow projection example by
 	// (c) 2002-2003 Phaetos <phaetos@gaffga.de>
 	float d, c;
-	float mat[16];
 	float nx, ny, nz, lx, ly, lz, px, py, pz;
 
 	nx = normal.x();
@@ -269,11 +420,30 @@ static void tglShadowProjection(Math::Vector3d light, Math::Vector3d plane, Math
 	mat[7] = ny;
 	mat[11] = nz;
 	mat[15] = -d;
+}
 
+static void tglShadowProjection(Math::Vector3d light, Math::Vector3d plane, Math::Vector3d normal, bool dontNegate) {
+	float mat[16];
+	shadowProjection(mat, light, plane, normal, dontNegate);
 	tglMultMatrixf(mat);
 }
 
-void GfxTinyGL::getBoundingBoxPos(const Mesh *model, int *x1, int *y1, int *x2, int *y2) {
+// the tgl functions take column major matrices, TinyGL's own are row major
+static void toM4(TinyGL::M4 *m, const float *mat) {
+	for (int i = 0; i < 4; i++) {
+		for (int j = 0; j < 4; j++)
+			m->m[i][j] = mat[j * 4 + i];
+	}
+}
+
+static void fromM4(float *mat, const TinyGL::M4 &m) {
+	for (int i = 0; i < 4; i++) {
+		for (int j = 0; j < 4; j++)
+			mat[j * 4 + i] = m.m[i][j];
+	}
+}
+
+void GfxTinyGL::getBoundingBoxPos(const Math::Vector3d *points, int count, int *x1, int *y1, int *x2, int *y2) {
 	if (_currentShadowArray) {
 		*x1 = -1;
 		*y1 = -1;
@@ -288,49 +458,46 @@ void GfxTinyGL::getBoundingBoxPos(const Mesh *model, int *x1, int *y1, int *x2,
 	TGLfloat bottom = -1000;
 	TGLfloat winX, winY, winZ;
 
-	for (int i = 0; i < model->_numFaces; i++) {
-		Math::Vector3d v;
-		float* pVertices;
-
-		for (int j = 0; j < model->_faces[i]._numVertices; j++) {
-			TGLfloat modelView[16], projection[16];
-			TGLint viewPort[4];
-
-			tglGetFloatv(TGL_MODELVIEW_MATRIX, modelView);
-			tglGetFloatv(TGL_PROJECTION_MATRIX, projection);
-			tglGetIntegerv(TGL_VIEWPORT, viewPort);
+	TGLfloat modelView[16], projection[16];
+	TGLint viewPort[4];
 
-			pVertices = model->_vertices + 3 * model->_faces[i]._vertices[j];
+	tglGetFloatv(TGL_MODELVIEW_MATRIX, modelView);
+	tglGetFloatv(TGL_PROJECTION_MATRIX, projection);
+	tglGetIntegerv(TGL_VIEWPORT, viewPort);
 
-			v.set(*(pVertices), *(pVertices + 1), *(pVertices + 2));
+	for (int i = 0; i < count; i++) {
+		const Math::Vector3d &v = points[i];
 
-			tgluProject(v.x(), v.y(), v.z(), modelView, projection, viewPort, &winX, &winY, &winZ);
+		tgluProject(v.x(), v.y(), v.z(), modelView, projection, viewPort, &winX, &winY, &winZ);
 
-			if (winX > right)
-				right = winX;
-			if (winX < left)
-				left = winX;
-			if (winY < top)
-				top = winY;
-			if (winY > bottom)
-				bottom = winY;
-		}
+		if (winX > right)
+			right = winX;
+		if (winX < left)
+			left = winX;
+		if (winY < top)
+			top = winY;
+		if (winY > bottom)
+			bottom = winY;
 	}
 
+	// the box is projected at the render resolution, the game wants it in
+	// its own coordinates
 	float t = bottom;
-	bottom = 480 - top;
-	top = 480 - t;
+	bottom = (_screenHeight - top) * _gameHeight / _screenHeight;
+	top = (_screenHeight - t) * _gameHeight / _screenHeight;
+	left = left * _gameWidth / _screenWidth;
+	right = right * _gameWidth / _screenWidth;
 
 	if (left < 0)
 		left = 0;
-	if (right > 639)
-		right = 639;
+	if (right > _gameWidth - 1)
+		right = _gameWidth - 1;
 	if (top < 0)
 		top = 0;
-	if (bottom > 479)
-		bottom = 479;
+	if (bottom > _gameHeight - 1)
+		bottom = _gameHeight - 1;
 
-	if (top > 479 || left > 639 || bottom < 0 || right < 0) {
+	if (top > _gameHeight - 1 || left > _gameWidth - 1 || bottom < 0 || right < 0) {
 		*x1 = -1;
 		*y1 = -1;
 		*x2 = -1;
@@ -364,13 +531,32 @@ void GfxTinyGL::startActorDraw(Math::Vector3d pos, float scale, const Math::Angl
 	tglEnable(TGL_TEXTURE_2D);
 	tglMatrixMode(TGL_MODELVIEW);
 	tglPushMatrix();
+
+	_cullActor = !_currentShadowArray && scale == 1.f;
+	if (_cullActor) {
+		TGLfloat mat[16];
+		tglGetFloatv(TGL_MODELVIEW_MATRIX, mat);
+		toM4(&_cullCamera, mat);
+		tglGetFloatv(TGL_PROJECTION_MATRIX, mat);
+		toM4(&_cullProjection, mat);
+
+		// the planes of the clip space box, taken back to world coordinates
+		TinyGL::M4 clip;
+		TinyGL::gl_M4_Mul(&clip, &_cullProjection, &_cullCamera);
+		for (int i = 0; i < 6; i++) {
+			float side = (i & 1) ? -1.f : 1.f;
+			float *plane = _cullPlanes[i];
+			for (int j = 0; j < 4; j++)
+				plane[j] = clip.m[3][j] + side * clip.m[i / 2][j];
+			float length = sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+			for (int j = 0; j < 4; j++)
+				plane[j] /= length;
+		}
+	}
+
 	if (_currentShadowArray) {
 		// TODO find out why shadowMask at device in woods is null
-		if (!_currentShadowArray->shadowMask) {
-			_currentShadowArray->shadowMask = new byte[_screenWidth * _screenHeight];
-			_currentShadowArray->shadowMaskSize = _screenWidth * _screenHeight;
-		}
-		assert(_currentShadowArray->shadowMask);
+		allocShadowMask(_currentShadowArray);
 		//tglSetShadowColor(255, 255, 255);
 		tglSetShadowColor(_shadowColorR, _shadowColorG, _shadowColorB);
 		tglSetShadowMaskBuf(_currentShadowArray->shadowMask);
@@ -390,6 +576,12 @@ void GfxTinyGL::finishActorDraw() {
 	tglMatrixMode(TGL_MODELVIEW);
 	tglPopMatrix();
 	tglDisable(TGL_TEXTURE_2D);
+	_cullActor = false;
+
+	// everything but the actors and the shadow planes writes straight to
+	// the frame buffer, so the queued triangles must land first
+	tglFlush();
+	addDrawnTriangles();
 
 	if (_currentShadowArray) {
 		tglSetShadowMaskBuf(NULL);
@@ -411,12 +603,106 @@ void GfxTinyGL::finishActorDraw() {
 	}*/
 }
 
+bool GfxTinyGL::isSphereVisible(const Math::Vector3d &center, float radius) {
+	// the shadows drawn along with the meshes land out of their bounds
+	if (!_cullActor || !_actorShadows.empty())
+		return true;
+
+	for (int i = 0; i < 6; i++) {
+		const float *plane = _cullPlanes[i];
+		if (plane[0] * center.x() + plane[1] * center.y() + plane[2] * center.z() + plane[3] < -radius)
+			return false;
+	}
+
+	// Is it behind the z bitmaps? The box around the sphere in the camera
+	// space is projected, the sphere is hidden when its closest point is
+	// deeper than the z bitmaps everywhere in the screen box.
+	TinyGL::V4 world, eye;
+	world.X = center.x();
+	world.Y = center.y();
+	world.Z = center.z();
+	world.W = 1.f;
+	TinyGL::gl_M4_MulV4(&eye, &_cullCamera, &world);
+
+	float x1 = _screenWidth, y1 = _screenHeight, x2 = 0, y2 = 0;
+	for (int i = 0; i < 8; i++) {
+		TinyGL::V4 corner, clip;
+		corner.X = eye.X + ((i & 1) ? radius : -radius);
+		corner.Y = eye.Y + ((i & 2) ? radius : -radius);
+		corner.Z = eye.Z + ((i & 4) ? radius : -radius);
+		corner.W = 1.f;
+		TinyGL::gl_M4_MulV4(&clip, &_cullProjection, &corner);
+		// reaches the camera plane, can't be projected
+		if (clip.W <= 0.f)
+			return true;
+		float x = (clip.X / clip.W + 1.f) * _screenWidth / 2;
+		float y = (1.f - clip.Y / clip.W) * _screenHeight / 2;
+		x1 = MIN(x1, x);
+		y1 = MIN(y1, y);
+		x2 = MAX(x2, x);
+		y2 = MAX(y2, y);
+	}
+
+	// the depth of the closest point, as the triangles write it
+	TinyGL::V4 closest, clip;
+	closest.X = eye.X;
+	closest.Y = eye.Y;
+	closest.Z = eye.Z + radius;
+	closest.W = 1.f;
+	TinyGL::gl_M4_MulV4(&clip, &_cullProjection, &closest);
+	float depth = (1.f - clip.Z / clip.W) * (1 << (ZB_Z_BITS - 1)) + 1;
+	if (depth >= 0xffff)
+		return true;
+
+	int left = MAX((int)x1 - 1, 0);
+	int top = MAX((int)y1 - 1, 0);
+	int right = MIN((int)x2 + 1, _screenWidth - 1);
+	int bottom = MIN((int)y2 + 1, _screenHeight - 1);
+	if (left > right || top > bottom)
+		return true;
+	return depth >= getBackgroundDepth(left, top, right, bottom);
+}
+
+void GfxTinyGL::buildDepthTiles() {
+	int tilesW = (_screenWidth + kDepthTileSize - 1) / kDepthTileSize;
+	int tilesH = (_screenHeight + kDepthTileSize - 1) / kDepthTileSize;
+	_depthTiles.resize(tilesW * tilesH);
+
+	for (int ty = 0; ty < tilesH; ty++) {
+		int yEnd = MIN((ty + 1) * kDepthTileSize, _screenHeight);
+		for (int tx = 0; tx < tilesW; tx++) {
+			int xEnd = MIN((tx + 1) * kDepthTileSize, _screenWidth);
+			uint16 depth = 0xffff;
+			for (int y = ty * kDepthTileSize; y < yEnd && depth; y++) {
+				const uint16 *z = _zb->zbuf + y * _screenWidth;
+				for (int x = tx * kDepthTileSize; x < xEnd; x++)
+					depth = MIN(depth, z[x]);
+			}
+			_depthTiles[ty * tilesW + tx] = depth;
+		}
+	}
+	_depthTilesValid = true;
+}
+
+// The smallest depth of the z bitmaps in the tiles covering the rectangle,
+// inclusive
+uint16 GfxTinyGL::getBackgroundDepth(int x1, int y1, int x2, int y2) {
+	if (!_depthTilesValid)
+		buildDepthTiles();
+
+	int tilesW = (_screenWidth + kDepthTileSize - 1) / kDepthTileSize;
+	uint16 depth = 0xffff;
+	for (int ty = y1 / kDepthTileSize; ty <= y2 / kDepthTileSize && depth; ty++) {
+		for (int tx = x1 / kDepthTileSize; tx <= x2 / kDepthTileSize; tx++)
+			depth = MIN(depth, _depthTiles[ty * tilesW + tx]);
+	}
+	return depth;
+}
+
 void GfxTinyGL::drawShadowPlanes() {
 	tglEnable(TGL_SHADOW_MASK_MODE);
-	if (!_currentShadowArray->shadowMask) {
-		_currentShadowArray->shadowMask = new byte[_screenWidth * _screenHeight];
-		_currentShadowArray->shadowMaskSize = _screenWidth * _screenHeight;
-	}
+	allocShadowMask(_currentShadowArray);
+	tglFlush();
 	memset(_currentShadowArray->shadowMask, 0, _screenWidth * _screenHeight);
 
 	tglSetShadowMaskBuf(_currentShadowArray->shadowMask);
@@ -429,10 +715,59 @@ void GfxTinyGL::drawShadowPlanes() {
 		}
 		tglEnd();
 	}
+	tglFlush();
 	tglSetShadowMaskBuf(NULL);
 	tglDisable(TGL_SHADOW_MASK_MODE);
 }
 
+void GfxTinyGL::allocShadowMask(Shadow *shadow) {
+	// the mask covers the whole render buffer, which may have been resized
+	// or come from a savegame made at another resolution
+	int size = _screenWidth * _screenHeight;
+	if (!shadow->shadowMask || shadow->shadowMaskSize != size) {
+		tglFlush();
+		delete[] shadow->shadowMask;
+		shadow->shadowMask = new byte[size];
+		shadow->shadowMaskSize = size;
+		memset(shadow->shadowMask, 0, size);
+	}
+}
+
+bool GfxTinyGL::setActorShadows(Shadow **shadows, int count) {
+	// EMI models don't go through drawMesh
+	if (g_grim->getGameType() == GType_MONKEY4)
+		return false;
+
+	_actorShadows.clear();
+	if (!shadows)
+		return true;
+
+	// The shadow of a mesh is the mesh drawn with the camera, then the
+	// projection on the shadow plane, then the mesh transformation. Right
+	// now the modelview only holds the camera, so each shadow gets
+	// camera * projection * camera^-1, to be applied to the modelview of
+	// the meshes.
+	TGLfloat mat[16];
+	TinyGL::M4 camera, cameraInv, projection, tmp;
+	tglMatrixMode(TGL_MODELVIEW);
+	tglGetFloatv(TGL_MODELVIEW_MATRIX, mat);
+	toM4(&camera, mat);
+	TinyGL::gl_M4_Inv(&cameraInv, &camera);
+
+	for (int i = 0; i < count; i++) {
+		ActorShadow actorShadow;
+		actorShadow.shadow = shadows[i];
+		allocShadowMask(shadows[i]);
+		Sector *shadowSector = shadows[i]->planeList.begin()->sector;
+		shadowProjection(mat, shadows[i]->pos, shadowSector->getVertices()[0], shadowSector->getNormal(), shadows[i]->dontNegate);
+		toM4(&projection, mat);
+		TinyGL::gl_M4_Mul(&tmp, &camera, &projection);
+		TinyGL::gl_M4_Mul(&actorShadow.projection, &tmp, &cameraInv);
+		_actorShadows.push_back(actorShadow);
+	}
+	return true;
+}
+
 void GfxTinyGL::setShadowMode() {
 	GfxBase::setShadowMode();
 	tglEnable(TGL_SHADOW_MODE);
@@ -508,6 +843,209 @@ void GfxTinyGL::drawModelFace(const MeshFace *face, float *vertices, float *vert
 	tglEnd();
 }
 
+// A mesh laid out for tglDrawElements. A vertex of the arrays is a pair of
+// a mesh vertex and a texture vertex, shared by all the faces using the pair.
+struct TinyGLMesh {
+	Common::Array<float> _vertices;		// sets of 3
+	Common::Array<float> _normals;		// sets of 3
+	Common::Array<float> _texCoords;	// sets of 2
+	// the faces as triangles, in the order glEnd splits the polygons
+	Common::Array<uint32> _indices;
+	// where the triangles of each face start in the indices
+	Common::Array<uint> _faceStart;
+
+	// The display list drawing the mesh, 0 until the mesh is first drawn.
+	// It binds the textures the materials had then, so it gets compiled
+	// again when one of them switches to another image.
+	TGLuint _list;
+	struct ListedTexture {
+		const Material *material;
+		const Texture *texture;
+		TGLuint name;
+	};
+	Common::Array<ListedTexture> _listTextures;
+};
+
+static const Texture *getSelectedTexture(const Material *material) {
+	const Texture *t = material->getData()->_textures + material->getActiveTexture();
+	return t->_width && t->_height ? t : NULL;
+}
+
+static TGLuint getTextureName(const Texture *t) {
+	return t && t->_texture ? *(const TGLuint *)t->_texture : 0;
+}
+
+static void bindMeshArrays(const TinyGLMesh *data) {
+	tglEnableClientState(TGL_VERTEX_ARRAY);
+	tglEnableClientState(TGL_NORMAL_ARRAY);
+	tglEnableClientState(TGL_TEXTURE_COORD_ARRAY);
+	tglVertexPointer(3, TGL_FLOAT, 0, &data->_vertices[0]);
+	tglNormalPointer(TGL_FLOAT, 0, &data->_normals[0]);
+	tglTexCoordPointer(2, TGL_FLOAT, 0, &data->_texCoords[0]);
+}
+
+static void unbindMeshArrays() {
+	tglDisableClientState(TGL_VERTEX_ARRAY);
+	tglDisableClientState(TGL_NORMAL_ARRAY);
+	tglDisableClientState(TGL_TEXTURE_COORD_ARRAY);
+}
+
+void GfxTinyGL::createMesh(Mesh *mesh) {
+	TinyGLMesh *data = new TinyGLMesh();
+	Common::HashMap<int, uint32> pairs;
+	data->_list = 0;
+
+	data->_faceStart.resize(mesh->_numFaces + 1);
+	for (int i = 0; i < mesh->_numFaces; i++) {
+		const MeshFace &face = mesh->_faces[i];
+		Common::Array<uint32> corners;
+		for (int j = 0; j < face._numVertices; j++) {
+			int v = face._vertices[j];
+			int t = face._texVertices ? face._texVertices[j] : -1;
+			int key = v * (mesh->_numTextureVerts + 1) + t + 1;
+			if (!pairs.contains(key)) {
+				pairs[key] = data->_vertices.size() / 3;
+				for (int k = 0; k < 3; k++) {
+					data->_vertices.push_back(mesh->_vertices[3 * v + k]);
+					data->_normals.push_back(mesh->_vertNormals[3 * v + k]);
+				}
+				data->_texCoords.push_back(t < 0 ? 0.f : mesh->_textureVerts[2 * t]);
+				data->_texCoords.push_back(t < 0 ? 0.f : mesh->_textureVerts[2 * t + 1]);
+			}
+			corners.push_back(pairs[key]);
+		}
+
+		data->_faceStart[i] = data->_indices.size();
+		for (int j = face._numVertices - 1; j >= 2; j--) {
+			data->_indices.push_back(corners[j]);
+			data->_indices.push_back(corners[0]);
+			data->_indices.push_back(corners[j - 1]);
+		}
+	}
+	data->_faceStart[mesh->_numFaces] = data->_indices.size();
+
+	mesh->_userData = data;
+}
+
+void GfxTinyGL::drawMesh(const Mesh *mesh) {
+	TinyGLMesh *data = (TinyGLMesh *)mesh->_userData;
+	if (data->_indices.empty())
+		return;
+
+	// the shadows go first, so the mesh still covers them as if they had
+	// been drawn in a pass of their own before the actor
+	if (!_actorShadows.empty()) {
+		bindMeshArrays(data);
+		drawMeshShadows(mesh);
+		unbindMeshArrays();
+	}
+
+	bool listValid = data->_list != 0;
+	for (uint i = 0; listValid && i < data->_listTextures.size(); i++) {
+		const TinyGLMesh::ListedTexture &listed = data->_listTextures[i];
+		const Texture *t = getSelectedTexture(listed.material);
+		listValid = t == listed.texture && getTextureName(t) == listed.name;
+	}
+	if (!listValid)
+		compileMesh(mesh, data);
+
+	if (data->_list)
+		tglCallList(data->_list);
+	else
+		drawMeshFaces(mesh, data, false);
+}
+
+void GfxTinyGL::compileMesh(const Mesh *mesh, TinyGLMesh *data) {
+	// the textures get created when their material is first selected,
+	// which must not end up in the list
+	for (int i = 0; i < mesh->_numFaces; i++) {
+		if (i == 0 || mesh->_faces[i]._material != mesh->_faces[i - 1]._material)
+			mesh->_faces[i]._material->select();
+	}
+
+	// without a free list the mesh is drawn straight away
+	if (!data->_list)
+		data->_list = tglGenLists(1);
+	if (!data->_list)
+		return;
+
+	data->_listTextures.clear();
+	tglNewList(data->_list, TGL_COMPILE);
+	drawMeshFaces(mesh, data, true);
+	tglEndList();
+}
+
+// With listTextures, records the textures selected for the display list
+void GfxTinyGL::drawMeshFaces(const Mesh *mesh, TinyGLMesh *data, bool listTextures) {
+	bindMeshArrays(data);
+
+	// submit the consecutive faces sharing a material in one call
+	int i = 0;
+	while (i < mesh->_numFaces) {
+		Material *material = mesh->_faces[i]._material;
+		int end = i + 1;
+		while (end < mesh->_numFaces && mesh->_faces[end]._material == material)
+			end++;
+
+		uint start = data->_faceStart[i];
+		uint count = data->_faceStart[end] - start;
+		if (count > 0) {
+			material->select();
+			tglDrawElements(TGL_TRIANGLES, count, TGL_UNSIGNED_INT, &data->_indices[start]);
+			if (listTextures) {
+				TinyGLMesh::ListedTexture listed;
+				listed.material = material;
+				listed.texture = getSelectedTexture(material);
+				listed.name = getTextureName(listed.texture);
+				data->_listTextures.push_back(listed);
+			}
+		}
+		i = end;
+	}
+
+	unbindMeshArrays();
+}
+
+void GfxTinyGL::drawMeshShadows(const Mesh *mesh) {
+	const TinyGLMesh *data = (const TinyGLMesh *)mesh->_userData;
+	TGLfloat mat[16];
+	TinyGL::M4 modelView, shadowModelView;
+	tglGetFloatv(TGL_MODELVIEW_MATRIX, mat);
+	toM4(&modelView, mat);
+
+	// the flat shadows need neither textures nor lighting
+	int lighting, texture2D;
+	tglGetIntegerv(TGL_LIGHTING, &lighting);
+	tglGetIntegerv(TGL_TEXTURE_2D, &texture2D);
+	tglDisable(TGL_TEXTURE_2D);
+	tglDisable(TGL_LIGHTING);
+	tglEnable(TGL_SHADOW_MODE);
+	tglSetShadowColor(_shadowColorR, _shadowColorG, _shadowColorB);
+	for (uint i = 0; i < _actorShadows.size(); i++) {
+		TinyGL::gl_M4_Mul(&shadowModelView, &_actorShadows[i].projection, &modelView);
+		fromM4(mat, shadowModelView);
+		tglPushMatrix();
+		tglLoadMatrixf(mat);
+		tglSetShadowMaskBuf(_actorShadows[i].shadow->shadowMask);
+		tglDrawElements(TGL_TRIANGLES, data->_indices.size(), TGL_UNSIGNED_INT, &data->_indices[0]);
+		tglPopMatrix();
+	}
+	tglSetShadowMaskBuf(NULL);
+	tglDisable(TGL_SHADOW_MODE);
+	if (lighting)
+		tglEnable(TGL_LIGHTING);
+	if (texture2D)
+		tglEnable(TGL_TEXTURE_2D);
+}
+
+void GfxTinyGL::destroyMesh(Mesh *mesh) {
+	TinyGLMesh *data = (TinyGLMesh *)mesh->_userData;
+	if (data && data->_list)
+		tglDeleteLists(data->_list, 1);
+	delete data;
+	mesh->_userData = NULL;
+}
+
 void GfxTinyGL::drawSprite(const Sprite *sprite) {
 	tglMatrixMode(TGL_TEXTURE);
 	tglLoadIdentity();
@@ -639,56 +1177,64 @@ void GfxTinyGL::createBitmap(BitmapData *bitmap) {
 	}
 }
 
-void TinyGLBlit(byte *dst, byte *src, int x, int y, int width, int height, bool trans) {
-	int srcPitch = width * 2;
-	int dstPitch = 640 * 2;
-	int srcX, srcY;
-	int l, r;
-
-	if (x > 639 || y > 479)
+void GfxTinyGL::blit(uint16 *dst, const byte *src, int x, int y, int width, int height, bool trans) {
+	// the destination rectangle at the render resolution, and its visible part
+	int dstX = toScreenX(x);
+	int dstY = toScreenY(y);
+	int dstWidth = toScreenX(x + width) - dstX;
+	int dstHeight = toScreenY(y + height) - dstY;
+	int clipX1 = MAX(dstX, 0);
+	int clipY1 = MAX(dstY, 0);
+	int clipX2 = MIN(dstX + dstWidth, _screenWidth);
+	int clipY2 = MIN(dstY + dstHeight, _screenHeight);
+
+	if (dstWidth <= 0 || dstHeight <= 0 || clipX1 >= clipX2 || clipY1 >= clipY2)
 		return;
 
-	if (x < 0) {
-		srcX = -x;
-		x = 0;
-	} else {
-		srcX = 0;
-	}
-	if (y < 0) {
-		srcY = -y;
-		y = 0;
-	} else {
-		srcY = 0;
+	if (dstWidth == width && dstHeight == height) {
+		int copyWidth = clipX2 - clipX1;
+		for (int l = clipY1; l < clipY2; l++) {
+			const byte *s = src + ((l - dstY) * width + (clipX1 - dstX)) * 2;
+			uint16 *d = dst + l * _screenWidth + clipX1;
+			if (!trans)
+				memcpy(d, s, copyWidth * 2);
+			else
+				TinyGL::ZB_copyRowColorKey(d, (const TinyGL::PIXEL *)s, copyWidth, 0xf81f);
+		}
+		return;
 	}
 
-	if (x + width > 640)
-		width -= (x + width) - 640;
-
-	if (y + height > 480)
-		height -= (y + height) - 480;
+	// scaled, pick the nearest source pixel
+	for (int l = clipY1; l < clipY2; l++) {
+		const byte *s = src + ((l - dstY) * height / dstHeight) * width * 2;
+		uint16 *d = dst + l * _screenWidth;
+		for (int r = clipX1; r < clipX2; r++) {
+			uint16 pixel = READ_UINT16(s + ((r - dstX) * width / dstWidth) * 2);
+			if (!trans || pixel != 0xf81f)
+				WRITE_UINT16(d + r, pixel);
+		}
+	}
+}
 
-	dst += (x + (y * 640)) * 2;
-	src += (srcX + (srcY * width)) * 2;
+void GfxTinyGL::fillRect(int x1, int y1, int x2, int y2, uint16 color) {
+	// fills every render pixel covered by the game pixels x1..x2, y1..y2
+	uint16 *dst = (uint16 *)_zb->pbuf;
+	int left = MAX(toScreenX(x1), 0);
+	int top = MAX(toScreenY(y1), 0);
+	int right = MIN(toScreenX(x2 + 1), _screenWidth);
+	int bottom = MIN(toScreenY(y2 + 1), _screenHeight);
+	if (left >= right || top >= bottom)
+		return;
 
-	int copyWidth = width * 2;
+	Common::Rect rect(left, top, right, bottom);
+	if (_primitivesRect.isEmpty())
+		_primitivesRect = rect;
+	else
+		_primitivesRect.extend(rect);
 
-	if (!trans) {
-		for (l = 0; l < height; l++) {
-			memcpy(dst, src, copyWidth);
-			dst += dstPitch;
-			src += srcPitch;
-		}
-	} else {
-		for (l = 0; l < height; l++) {
-			for (r = 0; r < copyWidth; r += 2) {
-				uint16 pixel = READ_UINT16(src + r);
-				if (pixel != 0xf81f)
-					WRITE_UINT16(dst + r, pixel);
-			}
-			dst += dstPitch;
-			src += srcPitch;
-		}
-	}
+	for (int y = top; y < bottom; y++)
+		for (int x = left; x < right; x++)
+			WRITE_UINT16(dst + _screenWidth * y + x, color);
 }
 
 void GfxTinyGL::drawBitmap(const Bitmap *bitmap) {
@@ -698,15 +1244,83 @@ void GfxTinyGL::drawBitmap(const Bitmap *bitmap) {
 	}
 
 	assert(bitmap->getActiveImage() > 0);
-	if (bitmap->getFormat() == 1)
-		TinyGLBlit((byte *)_zb->pbuf, (byte *)bitmap->getData(bitmap->getActiveImage() - 1),
+	if (bitmap->getFormat() == 1) {
+		addDrawnRect(bitmap->getData(bitmap->getActiveImage() - 1),
+					 toScreenRect(bitmap->getX(), bitmap->getY(), bitmap->getWidth(), bitmap->getHeight()));
+		blit((uint16 *)_zb->pbuf, (byte *)bitmap->getData(bitmap->getActiveImage() - 1),
 			bitmap->getX(), bitmap->getY(), bitmap->getWidth(), bitmap->getHeight(), true);
-	else
-		TinyGLBlit((byte *)_zb->zbuf, (byte *)bitmap->getData(bitmap->getActiveImage() - 1),
+	} else {
+		// only hides parts of the actors, which are redrawn every frame anyway
+		blit(_zb->zbuf, (byte *)bitmap->getData(bitmap->getActiveImage() - 1),
 			bitmap->getX(), bitmap->getY(), bitmap->getWidth(), bitmap->getHeight(), false);
+		_depthTilesValid = false;
+	}
+}
+
+void GfxTinyGL::destroyBitmap(BitmapData *bitmap) {
+	for (int pic = 0; pic < bitmap->_numImages; pic++)
+		forgetDrawnData(bitmap->getImageData(pic));
+}
+
+bool GfxTinyGL::restoreBackground(const void *key, uint version) {
+	for (uint i = 0; i < _backgrounds.size(); i++) {
+		if (_backgrounds[i].key != key)
+			continue;
+
+		StoredBackground background = _backgrounds[i];
+		if (background.version != version || background.renderBitmaps != _renderBitmaps ||
+			background.renderZBitmaps != _renderZBitmaps)
+			return false;
+
+		tglFlush();
+		memcpy(_zb->pbuf, background.pixels, _screenWidth * _screenHeight * 2);
+		memcpy(_zb->zbuf, background.zbuf, _screenWidth * _screenHeight * 2);
+		memset(_zb->zbuf2, 0, _screenWidth * _screenHeight * 4);
+		_depthTilesValid = false;
+		addDrawnRect(background.pixels, Common::Rect(_screenWidth, _screenHeight));
+
+		_backgrounds.remove_at(i);
+		_backgrounds.push_back(background);
+		return true;
+	}
+	return false;
+}
+
+void GfxTinyGL::storeBackground(const void *key, uint version) {
+	forgetBackground(key);
+	if (_backgrounds.size() >= kMaxStoredBackgrounds) {
+		freeBackground(_backgrounds[0]);
+		_backgrounds.remove_at(0);
+	}
+
+	tglFlush();
+	StoredBackground background;
+	background.key = key;
+	background.version = version;
+	background.renderBitmaps = _renderBitmaps;
+	background.renderZBitmaps = _renderZBitmaps;
+	background.pixels = new byte[_screenWidth * _screenHeight * 2];
+	background.zbuf = new uint16[_screenWidth * _screenHeight];
+	memcpy(background.pixels, _zb->pbuf, _screenWidth * _screenHeight * 2);
+	memcpy(background.zbuf, _zb->zbuf, _screenWidth * _screenHeight * 2);
+	_backgrounds.push_back(background);
+}
+
+void GfxTinyGL::forgetBackground(const void *key) {
+	for (uint i = 0; i < _backgrounds.size(); i++) {
+		if (_backgrounds[i].key == key) {
+			freeBackground(_backgrounds[i]);
+			_backgrounds.remove_at(i);
+			return;
+		}
+	}
 }
 
-void GfxTinyGL::destroyBitmap(BitmapData *) { }
+void GfxTinyGL::freeBackground(StoredBackground &background) {
+	forgetDrawnData(background.pixels);
+	delete[] background.pixels;
+	delete[] background.zbuf;
+}
 
 void GfxTinyGL::createFont(Font *font) {
 }
@@ -795,7 +1409,8 @@ void GfxTinyGL::drawTextObject(TextObject *text) {
 	if (userData) {
 		int numLines = text->getNumLines();
 		for (int i = 0; i < numLines; ++i) {
-			TinyGLBlit((byte *)_zb->pbuf, userData[i].data, userData[i].x, userData[i].y, userData[i].width, userData[i].height, true);
+			addDrawnRect(userData[i].data, toScreenRect(userData[i].x, userData[i].y, userData[i].width, userData[i].height));
+			blit((uint16 *)_zb->pbuf, userData[i].data, userData[i].x, userData[i].y, userData[i].width, userData[i].height, true);
 		}
 	}
 
@@ -806,6 +1421,7 @@ void GfxTinyGL::destroyTextObject(TextObject *text) {
 	if (userData) {
 		int numLines = text->getNumLines();
 		for (int i = 0; i < numLines; ++i) {
+			forgetDrawnData(userData[i].data);
 			delete[] userData[i].data;
 		}
 		delete[] userData;
@@ -815,8 +1431,25 @@ void GfxTinyGL::destroyTextObject(TextObject *text) {
 void GfxTinyGL::createMaterial(Texture *material, const char *data, const CMap *cmap) {
 	if (g_grim->getGameType() == GType_MONKEY4)
 		return;
+	MaterialData *materialData = material->_materialData;
+	Common::String key = Common::String::format("%s:%d:%s", materialData->_fname.c_str(),
+												(int)(material - materialData->_textures), cmap->getFilename().c_str());
 	material->_texture = new TGLuint[1];
+	for (uint i = 0; i < _textureCache.size(); i++) {
+		if (_textureCache[i].key == key) {
+			_textureCache[i].refCount++;
+			*(TGLuint *)material->_texture = _textureCache[i].texture;
+			return;
+		}
+	}
+
 	tglGenTextures(1, (TGLuint *)material->_texture);
+	CachedTexture cached;
+	cached.key = key;
+	cached.texture = *(TGLuint *)material->_texture;
+	cached.refCount = 1;
+	_textureCache.push_back(cached);
+
 	char *texdata = new char[material->_width * material->_height * 4];
 	char *texdatapos = texdata;
 	for (int y = 0; y < material->_height; y++) {
@@ -859,8 +1492,39 @@ void GfxTinyGL::selectMaterial(const Texture *material) {
 }
 
 void GfxTinyGL::destroyMaterial(Texture *material) {
-	tglDeleteTextures(1, (TGLuint *)material->_texture);
-	delete[] (TGLuint *)material->_texture;
+	TGLuint *textures = (TGLuint *)material->_texture;
+	for (uint i = 0; i < _textureCache.size(); i++) {
+		if (_textureCache[i].texture != textures[0])
+			continue;
+		if (--_textureCache[i].refCount == 0) {
+			// keep it around, the most recently released last
+			CachedTexture released = _textureCache[i];
+			_textureCache.remove_at(i);
+			_textureCache.push_back(released);
+			freeUnusedTextures(kMaxUnusedTextures);
+		}
+		delete[] textures;
+		return;
+	}
+	tglDeleteTextures(1, textures);
+	delete[] textures;
+}
+
+void GfxTinyGL::freeUnusedTextures(uint keep) {
+	uint unused = 0;
+	for (uint i = 0; i < _textureCache.size(); i++) {
+		if (_textureCache[i].refCount == 0)
+			unused++;
+	}
+	for (uint i = 0; i < _textureCache.size() && unused > keep;) {
+		if (_textureCache[i].refCount == 0) {
+			tglDeleteTextures(1, &_textureCache[i].texture);
+			_textureCache.remove_at(i);
+			unused--;
+		} else {
+			i++;
+		}
+	}
 }
 
 void GfxTinyGL::prepareMovieFrame(Graphics::Surface* frame) {
@@ -870,10 +1534,11 @@ void GfxTinyGL::prepareMovieFrame(Graphics::Surface* frame) {
 }
 
 void GfxTinyGL::drawMovieFrame(int offsetX, int offsetY) {
-	if (_smushWidth == 640 && _smushHeight == 480) {
-		memcpy(_zb->pbuf, _smushBitmap, 640 * 480 * 2);
+	addDrawnRect(NULL, toScreenRect(offsetX, offsetY, _smushWidth, _smushHeight));
+	if (_smushWidth == _screenWidth && _smushHeight == _screenHeight) {
+		memcpy(_zb->pbuf, _smushBitmap, _screenWidth * _screenHeight * 2);
 	} else {
-		TinyGLBlit((byte *)_zb->pbuf, _smushBitmap, offsetX, offsetY, _smushWidth, _smushHeight, false);
+		blit((uint16 *)_zb->pbuf, _smushBitmap, offsetX, offsetY, _smushWidth, _smushHeight, false);
 	}
 }
 
@@ -891,16 +1556,12 @@ void GfxTinyGL::drawEmergString(int x, int y, const char *text, const Color &fgC
 		assert(c >= 32 && c <= 127);
 		const uint8 *ptr = Font::emerFont[c - 32];
 		for (int py = 0; py < 13; py++) {
-			if ((py + y) < 480 && (py + y) >= 0) {
-				int line = ptr[12 - py];
-				for (int px = 0; px < 8; px++) {
-					if ((px + x) < 640 && (px + x) >= 0) {
-						int pixel = line & 0x80;
-						line <<= 1;
-						if (pixel)
-							WRITE_UINT16(_zb->pbuf + ((py + y) * 640) + (px + x), color);
-					}
-				}
+			int line = ptr[12 - py];
+			for (int px = 0; px < 8; px++) {
+				int pixel = line & 0x80;
+				line <<= 1;
+				if (pixel)
+					fillRect(px + x, py + y, px + x, py + y, color);
 			}
 		}
 		x += 10;
@@ -909,30 +1570,36 @@ void GfxTinyGL::drawEmergString(int x, int y, const char *text, const Color &fgC
 
 Bitmap *GfxTinyGL::getScreenshot(int w, int h) {
 	uint16 *buffer = new uint16[w * h];
-	uint16 *src = (uint16 *)_storedDisplay;
-	assert(buffer);
-
-	int step = 0;
-	for (int y = 0; y <= 479; y++) {
-		for (int x = 0; x <= 639; x++) {
-			uint16 pixel = *(src + y * 640 + x);
-			uint8 r = (pixel & 0xF800) >> 8;
-			uint8 g = (pixel & 0x07E0) >> 3;
-			uint8 b = (pixel & 0x001F) << 3;
-			uint32 color = (r + g + b) / 3;
-			src[step++] = ((color & 0xF8) << 8) | ((color & 0xFC) << 3) | (color >> 3);
+	const uint16 *src = (const uint16 *)_storedDisplay;
+	byte *grays = new byte[_screenWidth];
+	uint16 *sums = new uint16[_screenWidth];
+
+	// every pixel is the mean gray of the area of the stored display it
+	// covers, which is left as it is
+	for (int y = 0; y < h; y++) {
+		int top = y * _screenHeight / h;
+		int bottom = MAX((y + 1) * _screenHeight / h, top + 1);
+		// the sums of the 8 bit grays are 16 bits
+		assert(bottom - top <= 257);
+
+		memset(sums, 0, _screenWidth * sizeof(uint16));
+		for (int l = top; l < bottom; l++) {
+			TinyGL::ZB_grayRow8(grays, src + l * _screenWidth, _screenWidth);
+			TinyGL::ZB_addRow8(sums, grays, _screenWidth);
 		}
-	}
 
-	float step_x = 640.0f / w;
-	float step_y = 480.0f / h;
-	step = 0;
-	for (float y = 0; y < 479; y += step_y) {
-		for (float x = 0; x < 639; x += step_x) {
-			uint16 pixel = *(src + (int)y * 640 + (int)x);
-			buffer[step++] = pixel;
+		for (int x = 0; x < w; x++) {
+			int left = x * _screenWidth / w;
+			int right = MAX((x + 1) * _screenWidth / w, left + 1);
+			uint32 sum = 0;
+			for (int c = left; c < right; c++)
+				sum += sums[c];
+			uint32 color = sum / ((right - left) * (bottom - top));
+			buffer[y * w + x] = ((color & 0xF8) << 8) | ((color & 0xFC) << 3) | (color >> 3);
 		}
 	}
+	delete[] grays;
+	delete[] sums;
 
 	Bitmap *screenshot = new Bitmap((char *)buffer, w, h, 16, "screenshot");
 	delete[] buffer;
@@ -940,54 +1607,60 @@ Bitmap *GfxTinyGL::getScreenshot(int w, int h) {
 }
 
 void GfxTinyGL::storeDisplay() {
-	memcpy(_storedDisplay, _zb->pbuf, 640 * 480 * 2);
+	memcpy(_storedDisplay, _zb->pbuf, _screenWidth * _screenHeight * 2);
 }
 
 void GfxTinyGL::copyStoredToDisplay() {
-	memcpy(_zb->pbuf, _storedDisplay, 640 * 480 * 2);
+	addDrawnRect(NULL, Common::Rect(_screenWidth, _screenHeight));
+	memcpy(_zb->pbuf, _storedDisplay, _screenWidth * _screenHeight * 2);
 }
 
 void GfxTinyGL::dimScreen() {
 	uint16 *data = (uint16 *)_storedDisplay;
-	for (int l = 0; l < 640 * 480; l++) {
-		uint16 pixel = data[l];
-		uint8 r = (pixel & 0xF800) >> 8;
-		uint8 g = (pixel & 0x07E0) >> 3;
-		uint8 b = (pixel & 0x001F) << 3;
-		uint32 color = (r + g + b) / 10;
-		data[l] = ((color & 0xF8) << 8) | ((color & 0xFC) << 3) | (color >> 3);
-	}
+	// a tenth of the sum of the channels
+	TinyGL::ZB_grayRow(data, data, _screenWidth * _screenHeight, 6554);
 }
 
 void GfxTinyGL::dimRegion(int x, int y, int w, int h, float level) {
 	uint16 *data = (uint16 *)_zb->pbuf;
-	for (int ly = y; ly < y + h; ly++) {
-		for (int lx = x; lx < x + w; lx++) {
-			uint16 pixel = data[ly * 640 + lx];
-			uint8 r = (pixel & 0xF800) >> 8;
-			uint8 g = (pixel & 0x07E0) >> 3;
-			uint8 b = (pixel & 0x001F) << 3;
-			uint16 color = (uint16)(((r + g + b) / 3) * level);
-			data[ly * 640 + lx] = ((color & 0xF8) << 8) | ((color & 0xFC) << 3) | (color >> 3);
-		}
+	int left = MAX(toScreenX(x), 0);
+	int top = MAX(toScreenY(y), 0);
+	int right = MIN(toScreenX(x + w), _screenWidth);
+	int bottom = MIN(toScreenY(y + h), _screenHeight);
+	if (left >= right || top >= bottom)
+		return;
+
+	addDrawnRect(NULL, Common::Rect(left, top, right, bottom));
+	uint scale = (uint)CLIP<float>(level * ZB_GRAY_SCALE, 0.f, 65535.f);
+	for (int ly = top; ly < bottom; ly++) {
+		uint16 *row = data + ly * _screenWidth + left;
+		TinyGL::ZB_grayRow(row, row, right - left, scale);
 	}
 }
 
 void GfxTinyGL::irisAroundRegion(int x1, int y1, int x2, int y2) {
 	uint16 *data = (uint16 *)_zb->pbuf;
+	x1 = toScreenX(x1);
+	y1 = toScreenY(y1);
+	x2 = toScreenX(x2);
+	y2 = toScreenY(y2);
+	addDrawnRect(NULL, Common::Rect(_screenWidth, _screenHeight));
+	// the pixels strictly inside the region are kept, everything around
+	// it is set to black
+	int left = CLIP(x1 + 1, 0, _screenWidth);
+	int right = CLIP(x2, left, _screenWidth);
 	for (int ly = 0; ly < _screenHeight; ly++) {
-		for (int lx = 0; lx < _screenWidth; lx++) {
-			// Don't do anything with the data in the region we draw Around
-			if(lx > x1 && lx < x2 && ly > y1 && ly < y2)
-				continue;
-			// But set everything around it to black.
-			data[ly * 640 + lx] = (uint16)0.0f;
+		uint16 *row = data + ly * _screenWidth;
+		if (ly > y1 && ly < y2) {
+			memset(row, 0, left * 2);
+			memset(row + right, 0, (_screenWidth - right) * 2);
+		} else {
+			memset(row, 0, _screenWidth * 2);
 		}
 	}
 }
 
 void GfxTinyGL::drawRectangle(PrimitiveObject *primitive) {
-	uint16 *dst = (uint16 *)_zb->pbuf;
 	int x1 = primitive->getP1().x;
 	int y1 = primitive->getP1().y;
 	int x2 = primitive->getP2().x;
@@ -997,33 +1670,16 @@ void GfxTinyGL::drawRectangle(PrimitiveObject *primitive) {
 	uint16 c = ((color.getRed() & 0xF8) << 8) | ((color.getGreen() & 0xFC) << 3) | (color.getBlue() >> 3);
 
 	if (primitive->isFilled()) {
-		for (; y1 <= y2; y1++)
-			if (y1 >= 0 && y1 < 480)
-				for (int x = x1; x <= x2; x++)
-					if (x >= 0 && x < 640)
-						WRITE_UINT16(dst + 640 * y1 + x, c);
+		fillRect(x1, y1, x2, y2, c);
 	} else {
-		if (y1 >= 0 && y1 < 480)
-			for (int x = x1; x <= x2; x++)
-				if (x >= 0 && x < 640)
-					WRITE_UINT16(dst + 640 * y1 + x, c);
-		if (y2 >= 0 && y2 < 480)
-			for (int x = x1; x <= x2; x++)
-				if (x >= 0 && x < 640)
-					WRITE_UINT16(dst + 640 * y2 + x, c);
-		if (x1 >= 0 && x1 < 640)
-			for (int y = y1; y <= y2; y++)
-				if (y >= 0 && y < 480)
-					WRITE_UINT16(dst + 640 * y + x1, c);
-		if (x2 >= 0 && x2 < 640)
-			for (int y = y1; y <= y2; y++)
-				if (y >= 0 && y < 480)
-					WRITE_UINT16(dst + 640 * y + x2, c);
+		fillRect(x1, y1, x2, y1, c);
+		fillRect(x1, y2, x2, y2, c);
+		fillRect(x1, y1, x1, y2, c);
+		fillRect(x2, y1, x2, y2, c);
 	}
 }
 
 void GfxTinyGL::drawLine(PrimitiveObject *primitive) {
-	uint16 *dst = (uint16 *)_zb->pbuf;
 	int x1 = primitive->getP1().x;
 	int y1 = primitive->getP1().y;
 	int x2 = primitive->getP2().x;
@@ -1033,23 +1689,18 @@ void GfxTinyGL::drawLine(PrimitiveObject *primitive) {
 	uint16 c = ((color.getRed() & 0xF8) << 8) | ((color.getGreen() & 0xFC) << 3) | (color.getBlue() >> 3);
 
 	if (x2 == x1) {
-		for (int y = y1; y <= y2; y++) {
-			if (x1 >= 0 && x1 < 640 && y >= 0 && y < 480)
-				WRITE_UINT16(dst + 640 * y + x1, c);
-		}
+		fillRect(x1, y1, x1, y2, c);
 	} else {
 		float m = (y2 - y1) / (x2 - x1);
 		int b = (int)(-m * x1 + y1);
 		for (int x = x1; x <= x2; x++) {
 			int y = (int)(m * x) + b;
-			if (x >= 0 && x < 640 && y >= 0 && y < 480)
-				WRITE_UINT16(dst + 640 * y + x, c);
+			fillRect(x, y, x, y, c);
 		}
 	}
 }
 
 void GfxTinyGL::drawPolygon(PrimitiveObject *primitive) {
-	uint16 *dst = (uint16 *)_zb->pbuf;
 	int x1 = primitive->getP1().x;
 	int y1 = primitive->getP1().y;
 	int x2 = primitive->getP2().x;
@@ -1068,15 +1719,13 @@ void GfxTinyGL::drawPolygon(PrimitiveObject *primitive) {
 	b = (int)(-m * x1 + y1);
 	for (int x = x1; x <= x2; x++) {
 		int y = (int)(m * x) + b;
-		if (x >= 0 && x < 640 && y >= 0 && y < 480)
-			WRITE_UINT16(dst + 640 * y + x, c);
+		fillRect(x, y, x, y, c);
 	}
 	m = (y4 - y3) / (x4 - x3);
 	b = (int)(-m * x3 + y3);
 	for (int x = x3; x <= x4; x++) {
 		int y = (int)(m * x) + b;
-		if (x >= 0 && x < 640 && y >= 0 && y < 480)
-			WRITE_UINT16(dst + 640 * y + x, c);
+		fillRect(x, y, x, y, c);
 	}
 }
 
@@ -23,6 +23,10 @@
 #ifndef GRIM_GFX_TINYGL_H
 #define GRIM_GFX_TINYGL_H
 
+#include "common/array.h"
+#include "common/rect.h"
+#include "common/str.h"
+
 #include "engines/grim/gfx_base.h"
 
 #include "graphics/tinygl/zgl.h"
@@ -32,6 +36,7 @@ namespace Grim {
 class ModelNode;
 class Mesh;
 class MeshFace;
+struct TinyGLMesh;
 
 class GfxTinyGL : public GfxBase {
 public:
@@ -50,7 +55,7 @@ public:
 
 	bool isHardwareAccelerated();
 
-	void getBoundingBoxPos(const Mesh *model, int *x1, int *y1, int *x2, int *y2);
+	void getBoundingBoxPos(const Math::Vector3d *points, int count, int *x1, int *y1, int *x2, int *y2);
 
 	void startActorDraw(Math::Vector3d pos, float scale, const Math::Angle &yaw,
 						const Math::Angle &pitch, const Math::Angle &roll);
@@ -73,6 +78,13 @@ public:
 	void drawModelFace(const MeshFace *face, float *vertices, float *vertNormals, float *textureVerts);
 	void drawSprite(const Sprite *sprite);
 
+	void createMesh(Mesh *mesh);
+	void drawMesh(const Mesh *mesh);
+	void destroyMesh(Mesh *mesh);
+	bool setActorShadows(Shadow **shadows, int count);
+	bool isSphereVisible(const Math::Vector3d &center, float radius);
+	bool isCulling() const { return true; }
+
 	void enableLights();
 	void disableLights();
 	void setupLight(Light *light, int lightId);
@@ -86,6 +98,10 @@ public:
 	void drawBitmap(const Bitmap *bitmap);
 	void destroyBitmap(BitmapData *bitmap);
 
+	bool restoreBackground(const void *key, uint version);
+	void storeBackground(const void *key, uint version);
+	void forgetBackground(const void *key);
+
 	void createFont(Font *font);
 	void destroyFont(Font *font);
 
@@ -115,7 +131,91 @@ public:
 protected:
 
 private:
+	// game coordinates to the render resolution, and back
+	int toScreenX(int x) const { return x * _screenWidth / _gameWidth; }
+	int toScreenY(int y) const { return y * _screenHeight / _gameHeight; }
+	int toGameX(int x) const { return x * _gameWidth / _screenWidth; }
+	int toGameY(int y) const { return y * _gameHeight / _screenHeight; }
+
+	void blit(uint16 *dst, const byte *src, int x, int y, int width, int height, bool trans);
+	void fillRect(int x1, int y1, int x2, int y2, uint16 color);
+	void allocShadowMask(Shadow *shadow);
+	void drawMeshShadows(const Mesh *mesh);
+	void buildDepthTiles();
+	uint16 getBackgroundDepth(int x1, int y1, int x2, int y2);
+	void compileMesh(const Mesh *mesh, TinyGLMesh *data);
+	void drawMeshFaces(const Mesh *mesh, TinyGLMesh *data, bool listTextures);
+
+	// A region drawn this frame and the pixels drawn there, NULL when they
+	// change every frame. A region drawn the same way in the previous frame
+	// was left as it was, the others make up the damage to present.
+	struct DrawnRect {
+		const void *data;
+		Common::Rect rect;
+	};
+	Common::Rect toScreenRect(int x, int y, int width, int height) const;
+	void addDrawnRect(const void *data, const Common::Rect &rect);
+	void addDrawnTriangles();
+	void addDirtyRect(Common::Rect rect);
+	void forgetDrawnData(const void *data);
+	void presentFrame();
+
+	// The composited background of a camera setup: the color, and the depth
+	// of the z bitmaps. The 32 bit depth only holds the actors.
+	struct StoredBackground {
+		const void *key;
+		uint version;
+		bool renderBitmaps, renderZBitmaps;
+		byte *pixels;
+		uint16 *zbuf;
+	};
+	void freeBackground(StoredBackground &background);
+
+	// A texture uploaded for an image of a material with a colormap,
+	// shared by all the materials loading the same pair. The released ones
+	// are kept for a while, the same pair often gets loaded again.
+	struct CachedTexture {
+		Common::String key;
+		TGLuint texture;
+		int refCount;
+	};
+	void freeUnusedTextures(uint keep);
+	enum { kMaxUnusedTextures = 32 };
+	// each takes 4 bytes per pixel
+	enum { kMaxStoredBackgrounds = 4 };
+
 	TinyGL::ZBuffer *_zb;
+	// the game draws its 2D elements for a screen of this size
+	int _gameWidth;
+	int _gameHeight;
+	int _screenChangeID;
+	Common::Array<DrawnRect> _drawnRects;
+	Common::Array<DrawnRect> _prevDrawnRects;
+	Common::Array<Common::Rect> _dirtyRects;
+	// what the primitives and the emergency font drew this frame
+	Common::Rect _primitivesRect;
+	bool _fullRedraw;
+	// the most recently used last
+	Common::Array<StoredBackground> _backgrounds;
+	Common::Array<CachedTexture> _textureCache;
+	// the shadows drawn along with the meshes of the current actor
+	struct ActorShadow {
+		Shadow *shadow;
+		TinyGL::M4 projection;
+	};
+	Common::Array<ActorShadow> _actorShadows;
+	// The view of the current actor, for isSphereVisible(): the frustum
+	// planes in world coordinates, the camera and the projection. Only the
+	// main pass of an unscaled actor is culled, the nodes' bounds know
+	// nothing of the scale or of the shadow projections.
+	bool _cullActor;
+	float _cullPlanes[6][4];
+	TinyGL::M4 _cullCamera, _cullProjection;
+	// the smallest depth of the z bitmaps in each tile of the screen, built
+	// when first needed after the depth changed
+	enum { kDepthTileSize = 16 };
+	Common::Array<uint16> _depthTiles;
+	bool _depthTilesValid;
 	byte *_screen;
 	byte *_smushBitmap;
 	int _smushWidth;
@@ -49,6 +49,7 @@
 #include "engines/engine.h"
 
 #include "engines/grim/debug.h"
+#include "engines/grim/debugger.h"
 #include "engines/grim/grim.h"
 #include "engines/grim/lua.h"
 #include "engines/grim/lua_v1.h"
@@ -62,7 +63,9 @@
 #include "engines/grim/gfx_base.h"
 #include "engines/grim/bitmap.h"
 #include "engines/grim/font.h"
+#include "engines/grim/framepacer.h"
 #include "engines/grim/primitives.h"
+#include "engines/grim/profiler.h"
 #include "engines/grim/objectstate.h"
 #include "engines/grim/set.h"
 
@@ -121,19 +124,27 @@ GrimEngine::GrimEngine(OSystem *syst, uint32 gameFlags, GrimGameType gameType, C
 	_textSpeed = 7;
 	_mode = _previousMode = NormalMode;
 	_flipEnable = true;
-	int speed = atol(g_registry->get("engine_speed", "30"));
-	if (speed <= 0 || speed > 100)
+	const char *speedString = g_registry->get("engine_speed", "30");
+	int speed = atol(speedString);
+	// an explicit 0 runs the frames as fast as they can be drawn
+	if (speed == 0 && speedString[0] == '0')
+		_speedLimitMs = 0;
+	else if (speed <= 0 || speed > 100)
 		_speedLimitMs = 30;
 	else
 		_speedLimitMs = 1000 / speed;
 	char buf[20];
-	sprintf(buf, "%d", 1000 / _speedLimitMs);
+	sprintf(buf, "%d", _speedLimitMs ? 1000 / _speedLimitMs : 0);
 	g_registry->set("engine_speed", buf);
 	_refreshDrawNeeded = true;
 	_listFilesIter = NULL;
 	_savedState = NULL;
 	_fps[0] = 0;
 	_iris = new Iris();
+	_profiler = new Profiler();
+	_framePacer = new FramePacer();
+	_tickTime = 0;
+	_debugger = new Debugger();
 
 	PoolColor *c = new PoolColor(0, 0, 0);
 	new PoolColor(255, 255, 255); // Default color for actors. Id == 2
@@ -202,6 +213,13 @@ GrimEngine::~GrimEngine() {
 	delete g_driver;
 	g_driver = NULL;
 	delete _iris;
+	delete _profiler;
+	delete _framePacer;
+	delete _debugger;
+}
+
+GUI::Debugger *GrimEngine::getDebugger() {
+	return _debugger;
 }
 
 Common::Error GrimEngine::run() {
@@ -431,21 +449,31 @@ void GrimEngine::luaUpdate() {
 		return;
 
 	// Update timing information
-	unsigned newStart = g_system->getMillis();
-	if (newStart < _frameStart) {
+	if (_framePacer->isFixedStep()) {
+		// only the ticks move the time on, the updates run for the events
+		// just let Lua react to them
+		_frameTime = _tickTime;
+		_tickTime = 0;
+	} else {
+		unsigned newStart = g_system->getMillis();
+		if (newStart < _frameStart) {
+			_frameStart = newStart;
+			return;
+		}
+		_frameTime = newStart - _frameStart;
 		_frameStart = newStart;
-		return;
 	}
-	_frameTime = newStart - _frameStart;
-	_frameStart = newStart;
 
 	if (_mode == PauseMode || _shortFrame) {
 		_frameTime = 0;
 	}
 
+	_profiler->begin(Profiler::LuaTasks);
 	LuaBase::instance()->update(_frameTime, _movieTime);
+	_profiler->end();
 
 	if (_currSet && (_mode == NormalMode || _mode == SmushMode)) {
+		_profiler->begin(Profiler::ActorUpdates);
 		// Update the actors. Do it here so that we are sure to react asap to any change
 		// in the actors state caused by lua.
 		foreach (Actor *a, Actor::getPool()) {
@@ -457,11 +485,14 @@ void GrimEngine::luaUpdate() {
 		}
 
 		_iris->update(_frameTime);
+		_profiler->end();
 	}
 
+	_profiler->begin(Profiler::TextUpdates);
 	foreach (TextObject *t, TextObject::getPool()) {
 		t->update();
 	}
+	_profiler->end();
 }
 
 void GrimEngine::updateDisplayScene() {
@@ -469,6 +500,7 @@ void GrimEngine::updateDisplayScene() {
 
 	if (_mode == SmushMode) {
 		if (g_movie->isPlaying()) {
+			_profiler->begin(Profiler::Movie);
 			_movieTime = g_movie->getMovieTime();
 			if (g_movie->isUpdateNeeded()) {
 				g_driver->prepareMovieFrame(g_movie->getDstSurface());
@@ -485,36 +517,54 @@ void GrimEngine::updateDisplayScene() {
 					_doFlip = false;
 			} else
 				g_driver->releaseMovieFrame();
+			_profiler->end();
 		}
 		// Draw Primitives
+		_profiler->begin(Profiler::Overlays);
 		foreach (PrimitiveObject *p, PrimitiveObject::getPool()) {
 			p->draw();
 		}
 		drawPrimitives();
+		_profiler->end();
 	} else if (_mode == NormalMode) {
 		if (!_currSet)
 			return;
 
 		cameraPostChangeHandle(_currSet->getSetup());
 
-		g_driver->clearScreen();
-
 		_prevSmushFrame = 0;
 		_movieTime = 0;
 
-		_currSet->drawBackground();
+		// The background and the object states below the actors only change
+		// along with the states, the renderer may keep them composited
+		Set::Setup *setup = _currSet->getCurrSetup();
+		uint statesVersion = ObjectState::getChangeCount();
+		_profiler->begin(Profiler::Background);
+		if (!g_driver->restoreBackground(setup, statesVersion)) {
+			g_driver->clearScreen();
+
+			_currSet->drawBackground();
+
+			_profiler->begin(Profiler::Bitmaps);
 
-		// Draw underlying scene components
-		// Background objects are drawn underneath everything except the background
-		// There are a bunch of these, especially in the tube-switcher room
-		_currSet->drawBitmaps(ObjectState::OBJSTATE_BACKGROUND);
+			// Draw underlying scene components
+			// Background objects are drawn underneath everything except the background
+			// There are a bunch of these, especially in the tube-switcher room
+			_currSet->drawBitmaps(ObjectState::OBJSTATE_BACKGROUND);
 
-		// Underlay objects are just above the background
-		_currSet->drawBitmaps(ObjectState::OBJSTATE_UNDERLAY);
+			// Underlay objects are just above the background
+			_currSet->drawBitmaps(ObjectState::OBJSTATE_UNDERLAY);
 
-		// State objects are drawn on top of other things, such as the flag
-		// on Manny's message tube
-		_currSet->drawBitmaps(ObjectState::OBJSTATE_STATE);
+			// State objects are drawn on top of other things, such as the flag
+			// on Manny's message tube
+			_currSet->drawBitmaps(ObjectState::OBJSTATE_STATE);
+			_profiler->end();
+
+			// a background that hasn't loaded yet must be drawn again
+			if (setup->_bkgndBm)
+				g_driver->storeBackground(setup, statesVersion);
+		}
+		_profiler->end();
 
 		// Play SMUSH Animations
 		// This should occur on top of all underlying scene objects,
@@ -523,6 +573,7 @@ void GrimEngine::updateDisplayScene() {
 		// This should not occur on top of everything though or Manny gets covered
 		// up when he's next to Glottis's service room
 		if (g_movie->isPlaying()) {
+			_profiler->begin(Profiler::Movie);
 			_movieTime = g_movie->getMovieTime();
 			if (g_movie->isUpdateNeeded()) {
 				g_driver->prepareMovieFrame(g_movie->getDstSurface());
@@ -532,13 +583,17 @@ void GrimEngine::updateDisplayScene() {
 				g_driver->drawMovieFrame(g_movie->getX(), g_movie->getY());
 			else
 				g_driver->releaseMovieFrame();
+			_profiler->end();
 		}
 
 		// Draw Primitives
+		_profiler->begin(Profiler::Overlays);
 		foreach (PrimitiveObject *p, PrimitiveObject::getPool()) {
 			p->draw();
 		}
+		_profiler->end();
 
+		_profiler->begin(Profiler::Actors);
 		_currSet->setupCamera();
 
 		g_driver->set3DMode();
@@ -548,17 +603,20 @@ void GrimEngine::updateDisplayScene() {
 		// Draw actors
 		foreach (Actor *a, Actor::getPool()) {
 			if (a->isInSet(_currSet->getName()) && a->isVisible())
-				a->draw();
+				a->draw(_framePacer->getInterpolation());
 			a->undraw(a->isInSet(_currSet->getName()) && a->isVisible());
 		}
 		flagRefreshShadowMask(false);
+		_profiler->end();
 
 		// Draw overlying scene components
 		// The overlay objects should be drawn on top of everything else,
 		// including 3D objects such as Manny and the message tube
+		_profiler->begin(Profiler::Overlays);
 		_currSet->drawBitmaps(ObjectState::OBJSTATE_OVERLAY);
 
 		drawPrimitives();
+		_profiler->end();
 	} else if (_mode == DrawMode) {
 		// FIXME: This should really be called only when necessary.
 		handleUserPaint();
@@ -576,6 +634,8 @@ void GrimEngine::doFlip() {
 
 	if (_showFps && _mode != DrawMode)
 		g_driver->drawEmergString(550, 25, _fps, Color(255, 255, 255));
+	if (_mode != DrawMode)
+		_profiler->draw();
 
 	if (_flipEnable)
 		g_driver->flipBuffer();
@@ -601,9 +661,11 @@ void GrimEngine::mainLoop() {
 	_refreshShadowMask = false;
 	_shortFrame = false;
 	bool resetShortFrame = false;
+	_framePacer->reset();
 
 	for (;;) {
-		uint32 startTime = g_system->getMillis();
+		_profiler->beginFrame();
+		int ticks = _framePacer->beginFrame();
 		if (_shortFrame) {
 			if (resetShortFrame) {
 				_shortFrame = false;
@@ -613,19 +675,29 @@ void GrimEngine::mainLoop() {
 
 		if (_savegameLoadRequest) {
 			savegameRestore();
+			// the time spent loading isn't for the game to catch up on
+			_framePacer->reset();
+			ticks = 0;
 		}
 		if (_savegameSaveRequest) {
 			savegameSave();
 		}
 
+		_profiler->begin(Profiler::IMuse);
 		g_imuse->flushTracks();
 		g_imuse->refreshScripts();
+		_profiler->end();
 
 		// Process events
+		_profiler->begin(Profiler::Events);
 		Common::Event event;
 		while (g_system->getEventManager()->pollEvent(event)) {
 			// Handle any buttons, keys and joystick operations
 			Common::EventType type = event.type;
+			if (type == Common::EVENT_KEYDOWN && event.kbd.hasFlags(Common::KBD_CTRL) && event.kbd.keycode == Common::KEYCODE_d) {
+				_debugger->attach();
+				continue;
+			}
 			if (type == Common::EVENT_KEYDOWN) {
 				if (_mode != DrawMode && _mode != SmushMode && (event.kbd.ascii == 'q')) {
 					handleExit();
@@ -650,29 +722,36 @@ void GrimEngine::mainLoop() {
 			// with GetControlState()
 			luaUpdate();
 		}
+		_profiler->end();
 
-		luaUpdate();
+		if (_framePacer->isFixedStep()) {
+			for (int i = 0; i < ticks; i++) {
+				foreach (Actor *a, Actor::getPool()) {
+					a->saveDrawTransform();
+				}
+				_tickTime = _framePacer->nextTick();
+				luaUpdate();
+			}
+		} else {
+			luaUpdate();
+		}
+		_debugger->onFrame();
 
 		if (_mode != PauseMode) {
 			updateDisplayScene();
+			_profiler->begin(Profiler::Flip);
 			doFlip();
+			_profiler->end();
 		}
 
 		if (g_imuseState != -1) {
 			g_imuse->setMusicState(g_imuseState);
 			g_imuseState = -1;
 		}
+		_profiler->endFrame();
 
-		uint32 endTime = g_system->getMillis();
-		if (startTime > endTime)
-			continue;
-		uint32 diffTime = endTime - startTime;
-		if (_speedLimitMs == 0)
-			continue;
-		if (diffTime < _speedLimitMs) {
-			uint32 delayTime = _speedLimitMs - diffTime;
-			g_system->delayMillis(delayTime);
-		}
+		g_resourceloader->updatePrefetch();
+		_framePacer->waitForFrameEnd(_speedLimitMs);
 	}
 }
 
@@ -958,8 +1037,9 @@ Set *GrimEngine::loadSet(const Common::String &name) {
 		if (g_grim->getGameType() == GType_MONKEY4) {
 			filename += "b";
 		}
+		ResourceLoadProfile profile("set", filename);
 		Common::SeekableReadStream *stream;
-		stream = g_resourceloader->openNewStreamFile(filename.c_str());
+		stream = g_resourceloader->openNewStreamFile(filename.c_str(), true);
 		if(!stream)
 			warning("Could not find scene file %s", name.c_str());
 
@@ -44,6 +44,9 @@ class ObjectState;
 class Set;
 class TextObject;
 class PrimitiveObject;
+class Debugger;
+class Profiler;
+class FramePacer;
 
 enum GrimGameType {
 	GType_GRIM,
@@ -81,6 +84,8 @@ public:
 	GrimEngine(OSystem *syst, uint32 gameFlags, GrimGameType gameType, Common::Platform platform, Common::Language language);
 	virtual ~GrimEngine();
 
+	virtual GUI::Debugger *getDebugger();
+
 	int getGameFlags() { return _gameFlags; }
 	GrimGameType getGameType() { return _gameType; }
 	Common::Language getGameLanguage() { return _gameLanguage; }
@@ -200,6 +205,11 @@ private:
 	Actor *_selectedActor;
 	Actor *_talkingActor;
 	Iris *_iris;
+	Profiler *_profiler;
+	FramePacer *_framePacer;
+	// the length of the tick luaUpdate() is to run, with a fixed step
+	unsigned _tickTime;
+	Debugger *_debugger;
 
 	uint32 _gameFlags;
 	GrimGameType _gameType;
@@ -41,7 +41,7 @@ KeyframeAnim::KeyframeAnim(const Common::String &fname, Common::SeekableReadStre
 		loadBinary(data);
 	else {
 		data->seek(0, SEEK_SET);
-		TextSplitter ts(data);
+		TextSplitter ts(_fname, data);
 		loadText(ts);
 	}
 	delete data;
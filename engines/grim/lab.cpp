@@ -20,16 +20,59 @@
  *
  */
 
+#if defined(POSIX)
+#define FORBIDDEN_SYMBOL_EXCEPTION_unistd_h
+#endif
+
 #include "common/endian.h"
+#include "common/fs.h"
 #include "common/file.h"
 #include "common/substream.h"
 #include "common/memstream.h"
+#include "common/bufferedstream.h"
+#include "common/algorithm.h"
 
 #include "engines/grim/grim.h"
 #include "engines/grim/lab.h"
 
+#if defined(POSIX)
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 namespace Grim {
 
+// Read-ahead of each member stream reading through the shared archive handle
+static const uint32 kLabMemberBufferSize = 4096;
+static const uint32 kPackedLabMemberBufferSize = 65536;
+
+/**
+ * A member stream reading from the archive handle shared by all the members
+ * of a Lab. Every read seeks the shared handle to the stream position first,
+ * like a pread(), and the seek and read pair is done under the Lab mutex so
+ * that iMuse can stream sounds while the main thread loads resources.
+ */
+class LabMemberStream : public Common::SafeSubReadStream {
+public:
+	LabMemberStream(Common::SeekableReadStream *parentStream, uint32 begin, uint32 end, const Common::Mutex &mutex) :
+		Common::SafeSubReadStream(parentStream, begin, end, DisposeAfterUse::NO), _mutex(mutex) {
+	}
+
+	virtual uint32 read(void *dataPtr, uint32 dataSize) {
+		Common::StackLock lock(_mutex);
+		return Common::SafeSubReadStream::read(dataPtr, dataSize);
+	}
+
+	virtual bool seek(int32 offset, int whence = SEEK_SET) {
+		Common::StackLock lock(_mutex);
+		return Common::SafeSubReadStream::seek(offset, whence);
+	}
+
+private:
+	const Common::Mutex &_mutex;
+};
+
 LabEntry::LabEntry()
 	: _name(Common::String()), _offset(0), _len(0), _parent(NULL) {
 }
@@ -52,11 +95,18 @@ bool Lab::open(const byte *memLab, const uint32 size) {
 	return loadLab();
 }
 
-bool Lab::open(const Common::String &filename) {
+bool Lab::open(const Common::String &filename, bool loadDirectory) {
 	_labFileName = filename;
 
 	close();
 
+	// Map the whole archive once, so the member streams can point straight
+	// into it without reopening the file for every resource.
+	if (mapLab(filename)) {
+		_f = new Common::MemoryReadStream(_mappedLab, _mappedSize);
+		return loadLab(loadDirectory);
+	}
+
 	Common::File *file = new Common::File();
 	if (!file->open(filename)) {
 		delete file;
@@ -64,18 +114,120 @@ bool Lab::open(const Common::String &filename) {
 	}
 
 	_f = (Common::SeekableReadStream *)file;
-	return loadLab();
+	return loadLab(loadDirectory);
+}
+
+#if defined(POSIX)
+static Common::String getLabPath(const Common::String &filename) {
+	Common::ArchiveMemberPtr member = SearchMan.getMember(filename);
+	const Common::FSNode *node = dynamic_cast<const Common::FSNode *>(member.get());
+	if (!node)
+		return Common::String();
+
+	return node->getPath();
+}
+#endif
+
+static bool hashRange(Common::SeekableReadStream &s, uint32 start, uint64 len, uint32 &hash) {
+	if (start > (uint32)s.size() || len > (uint32)s.size() - start)
+		return false;
+
+	byte buf[4096];
+	s.seek(start);
+	while (len > 0) {
+		uint32 n = s.read(buf, MIN<uint32>(len, sizeof(buf)));
+		if (n == 0)
+			return false;
+		for (uint32 i = 0; i < n; i++)
+			hash = (hash ^ buf[i]) * 16777619u;
+		len -= n;
+	}
+	return true;
+}
+
+bool Lab::getArchiveStamp(const Common::String &filename, uint32 &size, uint32 &hash) {
+	// There is no portable way to get the modification time, the directory
+	// is hashed instead: a replaced archive will have its members elsewhere
+	Common::File file;
+	if (!file.open(filename))
+		return false;
+
+	size = file.size();
+	uint32 tag = file.readUint32BE();
+	file.readUint32LE(); // version
+	uint32 entryCount = file.readUint32LE();
+	uint32 stringTableSize = file.readUint32LE();
+	if (file.eos())
+		return false;
+
+	hash = 2166136261u;
+	if (tag == MKTAG('L','A','B','P'))
+		return hashRange(file, 0, 20 + 12 * (uint64)entryCount + stringTableSize, hash);
+	if (tag != MKTAG('L','A','B','N'))
+		return false;
+	if (g_grim->getGameType() == GType_GRIM)
+		return hashRange(file, 0, 16 * ((uint64)entryCount + 1) + stringTableSize, hash);
+
+	uint32 stringTableOffset = file.readUint32LE() - 0x13d0f;
+	return hashRange(file, 0, 20 + 16 * (uint64)entryCount, hash) &&
+		   hashRange(file, stringTableOffset, stringTableSize, hash);
+}
+
+bool Lab::mapLab(const Common::String &filename) {
+#if defined(POSIX)
+	Common::String path = getLabPath(filename);
+	if (path.empty())
+		return false;
+
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	off_t size = lseek(fd, 0, SEEK_END);
+	if (size <= 0 || (uint64)size > 0xffffffffULL) {
+		::close(fd);
+		return false;
+	}
+
+	void *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	// The mapping stays valid after the descriptor is closed
+	::close(fd);
+	if (data == MAP_FAILED)
+		return false;
+
+	_mappedLab = (const byte *)data;
+	_mappedSize = size;
+	return true;
+#else
+	return false;
+#endif
+}
+
+void Lab::unmapLab() {
+#if defined(POSIX)
+	if (_mappedLab)
+		munmap(const_cast<byte *>(_mappedLab), _mappedSize);
+#endif
+	_mappedLab = NULL;
+	_mappedSize = 0;
 }
 
-bool Lab::loadLab() {
-	if (_f->readUint32BE() != MKTAG('L','A','B','N')) {
+bool Lab::loadLab(bool loadDirectory) {
+	uint32 tag = _f->readUint32BE();
+	if (tag != MKTAG('L','A','B','N') && tag != MKTAG('L','A','B','P')) {
 		close();
 		return false;
 	}
 
 	_f->readUint32LE(); // version
+	_packed = (tag == MKTAG('L','A','B','P'));
 
-	if (g_grim->getGameType() == GType_GRIM)
+	if (!loadDirectory)
+		return true;
+
+	if (_packed)
+		parsePackedFileTable();
+	else if (g_grim->getGameType() == GType_GRIM)
 		parseGrimFileTable();
 	else
 		parseMonkey4FileTable();
@@ -146,6 +298,132 @@ void Lab::parseMonkey4FileTable() {
 	delete[] stringTable;
 }
 
+void Lab::parsePackedFileTable() {
+	uint32 entryCount = _f->readUint32LE();
+	uint32 stringTableSize = _f->readUint32LE();
+	_f->readUint32LE(); // alignment
+
+	byte *table = new byte[12 * entryCount];
+	_f->read(table, 12 * entryCount);
+	char *stringTable = new char[stringTableSize + 1];
+	_f->read(stringTable, stringTableSize);
+	stringTable[stringTableSize] = '\0';
+
+	for (uint32 i = 0; i < entryCount; i++) {
+		const byte *e = table + 12 * i;
+		uint32 fnameOffset = READ_LE_UINT32(e);
+		if (fnameOffset >= stringTableSize)
+			break;
+
+		// The names are stored in lower case already
+		Common::String fname = stringTable + fnameOffset;
+		LabEntry *entry = new LabEntry(fname, READ_LE_UINT32(e + 4), READ_LE_UINT32(e + 8), this);
+		_entries[fname] = LabEntryPtr(entry);
+	}
+
+	delete[] table;
+	delete[] stringTable;
+}
+
+struct PackedNameComparator {
+	const Common::StringArray &_names;
+	PackedNameComparator(const Common::StringArray &names) : _names(names) {}
+	bool operator()(uint32 l, uint32 r) const { return _names[l] < _names[r]; }
+};
+
+static void writePadding(Common::WriteStream *out, uint32 pos) {
+	static const byte zeros[64] = { 0 };
+	uint32 padding = (Lab::kPackedLabAlignment - pos % Lab::kPackedLabAlignment) % Lab::kPackedLabAlignment;
+	while (padding > 0) {
+		uint32 n = MIN<uint32>(padding, sizeof(zeros));
+		out->write(zeros, n);
+		padding -= n;
+	}
+}
+
+bool Lab::writePacked(Common::WriteStream *out, Common::Archive &source, const Common::StringArray &members) {
+	Common::StringArray names;
+	Common::Array<uint32> sizes;
+	Common::HashMap<Common::String, bool> added;
+	for (Common::StringArray::const_iterator i = members.begin(); i != members.end(); ++i) {
+		Common::String name(*i);
+		name.toLowercase();
+		if (added.contains(name) || !source.hasFile(name))
+			continue;
+
+		Common::SeekableReadStream *stream = source.createReadStreamForMember(name);
+		if (!stream)
+			continue;
+		names.push_back(name);
+		sizes.push_back(stream->size());
+		added[name] = true;
+		delete stream;
+	}
+
+	uint32 count = names.size();
+	Common::Array<uint32> sorted;
+	for (uint32 i = 0; i < count; i++)
+		sorted.push_back(i);
+	Common::sort(sorted.begin(), sorted.end(), PackedNameComparator(names));
+
+	// Lay out the members in the order they were given
+	Common::Array<uint32> nameOffsets, starts;
+	uint32 stringTableSize = 0;
+	for (uint32 i = 0; i < count; i++) {
+		nameOffsets.push_back(stringTableSize);
+		stringTableSize += names[i].size() + 1;
+	}
+	uint32 headerSize = 20 + 12 * count + stringTableSize;
+	uint32 pos = (headerSize + kPackedLabAlignment - 1) / kPackedLabAlignment * kPackedLabAlignment;
+	for (uint32 i = 0; i < count; i++) {
+		starts.push_back(pos);
+		uint32 end = pos + sizes[i];
+		if (end < pos) {
+			warning("Lab::writePacked(): The packed archive is larger than 4 GB");
+			return false;
+		}
+		pos = (end + kPackedLabAlignment - 1) / kPackedLabAlignment * kPackedLabAlignment;
+	}
+
+	out->writeUint32BE(MKTAG('L','A','B','P'));
+	out->writeUint32LE(1); // version
+	out->writeUint32LE(count);
+	out->writeUint32LE(stringTableSize);
+	out->writeUint32LE(kPackedLabAlignment);
+	for (uint32 i = 0; i < count; i++) {
+		uint32 n = sorted[i];
+		out->writeUint32LE(nameOffsets[n]);
+		out->writeUint32LE(starts[n]);
+		out->writeUint32LE(sizes[n]);
+	}
+	for (uint32 i = 0; i < count; i++)
+		out->write(names[i].c_str(), names[i].size() + 1);
+	writePadding(out, headerSize);
+
+	byte *buf = new byte[kPackedLabAlignment];
+	for (uint32 i = 0; i < count && !out->err(); i++) {
+		Common::SeekableReadStream *stream = source.createReadStreamForMember(names[i]);
+		uint32 left = sizes[i];
+		while (stream && left > 0) {
+			uint32 n = stream->read(buf, MIN(left, kPackedLabAlignment));
+			if (n == 0)
+				break;
+			out->write(buf, n);
+			left -= n;
+		}
+		delete stream;
+		if (left > 0) {
+			warning("Lab::writePacked(): Could not read %s", names[i].c_str());
+			delete[] buf;
+			return false;
+		}
+		writePadding(out, sizes[i]);
+	}
+	delete[] buf;
+
+	return !out->err();
+}
+
 bool Lab::hasFile(const Common::String &filename) {
 	Common::String fname(filename);
 	fname.toLowercase();
@@ -185,16 +463,37 @@ Common::SeekableReadStream *Lab::createReadStreamForMember(const Common::String
 	Common::String fname(filename);
 	fname.toLowercase();
 	LabEntryPtr i = _entries[fname];
+	return createReadStream(i->_offset, i->_len);
+}
+
+Common::SeekableReadStream *Lab::createReadStream(uint32 offset, uint32 len) const {
+	// A corrupt directory could point anywhere
+	if (offset + len < offset)
+		return 0;
 
-	/*If the whole Lab has been loaded into ram, we return a MemoryReadStream
+	/*If the whole Lab has been loaded into ram or mapped, we return a MemoryReadStream
 	that map requested data directly, without copying them. Otherwise open a new
-	stream from disk.*/
-	if(_memLab)
-		return new Common::MemoryReadStream((_memLab + i->_offset), i->_len, DisposeAfterUse::NO);
+	stream reading from the archive handle shared by all the members.*/
+	if (_memLab || _mappedLab) {
+		const byte *data = _memLab ? _memLab : _mappedLab;
+		if (offset + len <= (uint32)_f->size())
+			return new Common::MemoryReadStream(data + offset, len, DisposeAfterUse::NO);
+
+		// A member past the end of a truncated archive is read through the
+		// stream below, which stops at the end of the data
+		warning("Lab::createReadStream(): A member lies past the end of %s", _labFileName.c_str());
+	}
 
-	Common::File *file = new Common::File();
-	file->open(_labFileName);
-	return new Common::SeekableSubReadStream(file, i->_offset, i->_offset + i->_len, DisposeAfterUse::YES );
+	Common::SeekableReadStream *stream;
+	{
+		// The substream constructor seeks the shared handle too
+		Common::StackLock lock(_fMutex);
+		stream = new LabMemberStream(_f, offset, offset + len, _fMutex);
+	}
+	// The members of a packed archive are read ahead further, since the
+	// resources used together are stored next to each other
+	return Common::wrapBufferedSeekableReadStream(stream, _packed ? kPackedLabMemberBufferSize : kLabMemberBufferSize,
+												  DisposeAfterUse::YES);
 }
 
 void Lab::close() {
@@ -204,6 +503,8 @@ void Lab::close() {
 	if(_memLab)
 		delete _memLab;
 
+	unmapLab();
+
 	_entries.clear();
 }
 
@@ -28,6 +28,8 @@
 #include "common/str.h"
 #include "common/archive.h"
 #include "common/file.h"
+#include "common/mutex.h"
+#include "common/str-array.h"
 #include "common/types.h"
 
 namespace Grim {
@@ -44,17 +46,40 @@ public:
 	Common::String getName() const { return _name; }
 	Common::SeekableReadStream *createReadStream() const;
 	friend class Lab;
+	friend class LabIndex;
 };
 
 class Lab : public Common::Archive {
 public:
-	Lab() : _f(NULL), _memLab(NULL) { }
+	Lab() : _f(NULL), _memLab(NULL), _mappedLab(NULL), _mappedSize(0), _packed(false) { }
 	~Lab() { close(); }
 
-	bool open(const Common::String &filename);
+	/**
+	 * Open an archive. Without loadDirectory the members can only be read
+	 * by their position, as LabIndex does.
+	 */
+	bool open(const Common::String &filename, bool loadDirectory = true);
 	bool open(const byte *memLab, const uint32 size);
 	void close();
 
+	/**
+	 * Get the size of an archive and a hash of its directory, used to tell
+	 * whether a saved index still matches it. Fails if the archive can't be
+	 * read or isn't one.
+	 */
+	static bool getArchiveStamp(const Common::String &filename, uint32 &size, uint32 &hash);
+
+	/**
+	 * Write the given members of source into a packed archive. The members
+	 * are stored in the given order, each one starting at a multiple of
+	 * kPackedLabAlignment, so that the resources used together are read
+	 * sequentially. The directory is sorted by name. Members missing from
+	 * source are skipped.
+	 */
+	static bool writePacked(Common::WriteStream *out, Common::Archive &source, const Common::StringArray &members);
+
+	static const uint32 kPackedLabAlignment = 4096;
+
 	// Common::Archive implementation
 	virtual bool hasFile(const Common::String &name); //TODO: Remove at next scummvm sync
 	virtual bool hasFile(const Common::String &name) const;
@@ -63,13 +88,24 @@ public:
 	virtual Common::SeekableReadStream *createReadStreamForMember(const Common::String &name) const;
 
 private:
-	bool loadLab();
+	friend class LabIndex;
+
+	bool loadLab(bool loadDirectory = true);
+	Common::SeekableReadStream *createReadStream(uint32 offset, uint32 len) const;
+	bool mapLab(const Common::String &filename);
+	void unmapLab();
 	void parseGrimFileTable();
 	void parseMonkey4FileTable();
+	void parsePackedFileTable();
 
 	Common::SeekableReadStream *_f;
+	// Serializes positional reads of the member streams sharing _f
+	Common::Mutex _fMutex;
 	const byte *_memLab;
+	const byte *_mappedLab;
+	uint32 _mappedSize;
 	Common::String _labFileName;
+	bool _packed;
 	typedef Common::SharedPtr<LabEntry> LabEntryPtr;
 	typedef Common::HashMap<Common::String, LabEntryPtr, Common::IgnoreCase_Hash, Common::IgnoreCase_EqualTo> LabMap;
 	LabMap _entries;
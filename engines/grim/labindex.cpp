@@ -0,0 +1,274 @@
+/* ResidualVM - A 3D game interpreter
+ *
+ * ResidualVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ *
+ */
+
+#include "common/algorithm.h"
+#include "common/endian.h"
+#include "common/hashmap.h"
+#include "common/hash-str.h"
+#include "common/memstream.h"
+
+#include "engines/grim/labindex.h"
+#include "engines/grim/lab.h"
+
+namespace Grim {
+
+#define LABINDEX_TAG	MKTAG('L','I','D','X')
+static const uint32 kLabIndexVersion = 2;
+
+LabIndex::LabIndex() : _table(NULL), _entries(NULL), _names(NULL), _count(0), _namesSize(0) {
+}
+
+LabIndex::~LabIndex() {
+	clear();
+}
+
+void LabIndex::clear() {
+	for (uint32 i = 0; i < _labs.size(); i++)
+		delete _labs[i];
+	_labs.clear();
+	_archives.clear();
+
+	delete[] _table;
+	_table = NULL;
+	_entries = NULL;
+	_names = NULL;
+	_count = 0;
+	_namesSize = 0;
+}
+
+struct IndexNameComparator {
+	const Common::Array<Common::String> &_names;
+	IndexNameComparator(const Common::Array<Common::String> &names) : _names(names) {}
+	bool operator()(uint32 l, uint32 r) const { return _names[l] < _names[r]; }
+};
+
+void LabIndex::build(const StampList &stamps, const Common::Array<Lab *> &labs) {
+	clear();
+	_archives = stamps;
+	_labs = labs;
+
+	// The first archive holding a name wins
+	Common::Array<Common::String> names;
+	Common::Array<uint32> archives, offsets, lengths;
+	Common::HashMap<Common::String, bool> seen;
+	uint32 namesSize = 0;
+	for (uint32 a = 0; a < labs.size(); a++) {
+		if (!labs[a])
+			continue;
+
+		for (Lab::LabMap::const_iterator i = labs[a]->_entries.begin(); i != labs[a]->_entries.end(); ++i) {
+			if (seen.contains(i->_key))
+				continue;
+			seen[i->_key] = true;
+			names.push_back(i->_key);
+			archives.push_back(a);
+			offsets.push_back(i->_value->_offset);
+			lengths.push_back(i->_value->_len);
+			namesSize += i->_key.size() + 1;
+		}
+		// The members are only read through the index from now on
+		labs[a]->_entries.clear();
+	}
+
+	Common::Array<uint32> sorted;
+	for (uint32 i = 0; i < names.size(); i++)
+		sorted.push_back(i);
+	Common::sort(sorted.begin(), sorted.end(), IndexNameComparator(names));
+
+	_count = names.size();
+	_namesSize = namesSize;
+	_table = new byte[_count * kEntrySize + _namesSize];
+	byte *entry = _table;
+	char *name = (char *)_table + _count * kEntrySize;
+	uint32 nameOffset = 0;
+	for (uint32 i = 0; i < _count; i++, entry += kEntrySize) {
+		uint32 n = sorted[i];
+		WRITE_LE_UINT32(entry, nameOffset);
+		WRITE_LE_UINT32(entry + 4, archives[n]);
+		WRITE_LE_UINT32(entry + 8, offsets[n]);
+		WRITE_LE_UINT32(entry + 12, lengths[n]);
+		memcpy(name + nameOffset, names[n].c_str(), names[n].size() + 1);
+		nameOffset += names[n].size() + 1;
+	}
+	_entries = _table;
+	_names = name;
+}
+
+bool LabIndex::load(Common::SeekableReadStream *in, const StampList &stamps) {
+	clear();
+
+	if (in->readUint32BE() != LABINDEX_TAG || in->readUint32LE() != kLabIndexVersion)
+		return false;
+
+	// Made from the same archives, in the same order
+	uint32 archiveCount = in->readUint32LE();
+	if (archiveCount != stamps.size())
+		return false;
+	for (uint32 i = 0; i < archiveCount; i++) {
+		uint16 nameLen = in->readUint16LE();
+		Common::String name;
+		for (uint16 j = 0; j < nameLen; j++)
+			name += (char)in->readByte();
+		uint32 size = in->readUint32LE();
+		uint32 hash = in->readUint32LE();
+		if (in->eos() || name != stamps[i].name || size != stamps[i].size || hash != stamps[i].hash)
+			return false;
+	}
+
+	uint32 count = in->readUint32LE();
+	uint32 namesSize = in->readUint32LE();
+	uint32 left = in->size() - in->pos();
+	if (in->eos() || count > left / kEntrySize || namesSize != left - count * kEntrySize || namesSize == 0)
+		return false;
+
+	byte *table = new byte[left];
+	if (in->read(table, left) != left) {
+		delete[] table;
+		return false;
+	}
+
+	const char *names = (const char *)table + count * kEntrySize;
+	bool valid = names[namesSize - 1] == '\0';
+	const char *prev = NULL;
+	for (uint32 i = 0; valid && i < count; i++) {
+		const byte *entry = table + i * kEntrySize;
+		uint32 nameOffset = READ_LE_UINT32(entry);
+		uint32 archive = READ_LE_UINT32(entry + 4);
+		uint32 offset = READ_LE_UINT32(entry + 8);
+		uint32 len = READ_LE_UINT32(entry + 12);
+		valid = nameOffset < namesSize && archive < archiveCount &&
+				offset <= stamps[archive].size && len <= stamps[archive].size - offset &&
+				(!prev || strcmp(prev, names + nameOffset) < 0);
+		prev = names + nameOffset;
+	}
+	if (!valid) {
+		warning("LabIndex::load(): Invalid index");
+		delete[] table;
+		return false;
+	}
+
+	_archives = stamps;
+	_labs.resize(archiveCount);
+	for (uint32 i = 0; i < archiveCount; i++)
+		_labs[i] = NULL;
+	_table = table;
+	_entries = table;
+	_names = names;
+	_count = count;
+	_namesSize = namesSize;
+	return true;
+}
+
+void LabIndex::save(Common::WriteStream *out) const {
+	out->writeUint32BE(LABINDEX_TAG);
+	out->writeUint32LE(kLabIndexVersion);
+	out->writeUint32LE(_archives.size());
+	for (StampList::const_iterator i = _archives.begin(); i != _archives.end(); ++i) {
+		out->writeUint16LE(i->name.size());
+		out->write(i->name.c_str(), i->name.size());
+		out->writeUint32LE(i->size);
+		out->writeUint32LE(i->hash);
+	}
+
+	out->writeUint32LE(_count);
+	out->writeUint32LE(_namesSize);
+	out->write(_entries, _count * kEntrySize);
+	out->write(_names, _namesSize);
+}
+
+const char *LabIndex::getEntryName(const byte *entry) const {
+	return _names + READ_LE_UINT32(entry);
+}
+
+const byte *LabIndex::findEntry(const Common::String &name) const {
+	Common::String fname(name);
+	fname.toLowercase();
+
+	uint32 lo = 0, hi = _count;
+	while (lo < hi) {
+		uint32 mid = (lo + hi) / 2;
+		const byte *entry = _entries + mid * kEntrySize;
+		int cmp = strcmp(fname.c_str(), getEntryName(entry));
+		if (cmp == 0)
+			return entry;
+		if (cmp < 0)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+	return NULL;
+}
+
+bool LabIndex::hasFile(const Common::String &name) const {
+	return findEntry(name) != NULL;
+}
+
+int LabIndex::listMembers(Common::ArchiveMemberList &list) const {
+	for (uint32 i = 0; i < _count; i++)
+		list.push_back(Common::ArchiveMemberPtr(new Common::GenericArchiveMember(getEntryName(_entries + i * kEntrySize), this)));
+
+	return _count;
+}
+
+int LabIndex::listMatchingMembers(Common::ArchiveMemberList &list, const Common::String &pattern) const {
+	// Only the matching members are made, not the whole list
+	int matches = 0;
+	for (uint32 i = 0; i < _count; i++) {
+		const char *name = getEntryName(_entries + i * kEntrySize);
+		if (Common::matchString(name, pattern.c_str(), true, true)) {
+			list.push_back(Common::ArchiveMemberPtr(new Common::GenericArchiveMember(name, this)));
+			++matches;
+		}
+	}
+
+	return matches;
+}
+
+const Common::ArchiveMemberPtr LabIndex::getMember(const Common::String &name) const {
+	const byte *entry = findEntry(name);
+	if (!entry)
+		return Common::ArchiveMemberPtr();
+
+	return Common::ArchiveMemberPtr(new Common::GenericArchiveMember(getEntryName(entry), this));
+}
+
+Common::SeekableReadStream *LabIndex::createReadStreamForMember(const Common::String &name) const {
+	const byte *entry = findEntry(name);
+	if (!entry)
+		return 0;
+
+	uint32 archive = READ_LE_UINT32(entry + 4);
+	Lab *lab = _labs[archive];
+	if (!lab) {
+		lab = new Lab();
+		if (!lab->open(_archives[archive].name, false)) {
+			warning("LabIndex::createReadStreamForMember(): Could not open %s", _archives[archive].name.c_str());
+			delete lab;
+			return 0;
+		}
+		_labs[archive] = lab;
+	}
+
+	return lab->createReadStream(READ_LE_UINT32(entry + 8), READ_LE_UINT32(entry + 12));
+}
+
+} // end of namespace Grim
@@ -0,0 +1,91 @@
+/* ResidualVM - A 3D game interpreter
+ *
+ * ResidualVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ *
+ */
+
+#ifndef GRIM_LABINDEX_H
+#define GRIM_LABINDEX_H
+
+#include "common/archive.h"
+#include "common/array.h"
+#include "common/str.h"
+
+namespace Grim {
+
+class Lab;
+
+/**
+ * The merged directory of a list of archives. Every member name is resolved
+ * once to the archive of the highest priority holding it, and kept with its
+ * position in a single table sorted by name. A saved index is loaded back
+ * in one read and searched in place, and the archives are only opened when
+ * one of their members is first read.
+ */
+class LabIndex : public Common::Archive {
+public:
+	struct Stamp {
+		Common::String name;
+		uint32 size, hash;
+	};
+	typedef Common::Array<Stamp> StampList;
+
+	LabIndex();
+	~LabIndex();
+
+	/**
+	 * Merge the directories of labs, given in decreasing priority and
+	 * matching stamps. The index takes the archives over, NULL ones are
+	 * skipped.
+	 */
+	void build(const StampList &stamps, const Common::Array<Lab *> &labs);
+	/**
+	 * Load an index written by save(). Fails if it was made from other
+	 * archives than the stamped ones, or is damaged.
+	 */
+	bool load(Common::SeekableReadStream *in, const StampList &stamps);
+	void save(Common::WriteStream *out) const;
+
+	// Common::Archive implementation
+	virtual bool hasFile(const Common::String &name) const;
+	virtual int listMembers(Common::ArchiveMemberList &list) const;
+	virtual int listMatchingMembers(Common::ArchiveMemberList &list, const Common::String &pattern) const;
+	virtual const Common::ArchiveMemberPtr getMember(const Common::String &name) const;
+	virtual Common::SeekableReadStream *createReadStreamForMember(const Common::String &name) const;
+
+private:
+	// An entry is the name offset, the archive, the offset and the length
+	static const uint32 kEntrySize = 16;
+
+	void clear();
+	const byte *findEntry(const Common::String &name) const;
+	const char *getEntryName(const byte *entry) const;
+
+	StampList _archives;
+	// Opened on first use, from the main thread only
+	mutable Common::Array<Lab *> _labs;
+	byte *_table;
+	const byte *_entries;
+	const char *_names;
+	uint32 _count, _namesSize;
+};
+
+} // end of namespace Grim
+
+#endif
@@ -621,6 +621,18 @@ void Lua_V1::MakeCurrentSet() {
 	g_grim->setSet(name);
 }
 
+/* Start reading the resources of a set in the background, so that
+ * scripts can warm up the next set, e.g. during a dialogue.
+ */
+void Lua_V1::PreloadSet() {
+	lua_Object nameObj = lua_getparam(1);
+	if (!lua_isstring(nameObj))
+		return;
+
+	const char *name = lua_getstring(nameObj);
+	g_resourceloader->prefetchSet(name);
+}
+
 void Lua_V1::MakeCurrentSetup() {
 	lua_Object setupObj = lua_getparam(1);
 	if (!lua_isnumber(setupObj))
@@ -1355,6 +1367,8 @@ struct luaL_reg grimMainOpcodes[] = {
 	{ "RestoreIMuse", LUA_OPCODE(Lua_V1, RestoreIMuse) },
 	{ "GetMemoryUsage", LUA_OPCODE(Lua_V1, GetMemoryUsage) },
 	{ "dofile", LUA_OPCODE(Lua_V1, new_dofile) },
+	// Savegames refer to the opcodes by index, new ones go at the end
+	{ "PreloadSet", LUA_OPCODE(Lua_V1, PreloadSet) },
 };
 
 static struct luaL_reg grimTextOpcodes[] = {
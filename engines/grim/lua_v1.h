@@ -153,6 +153,7 @@ protected:
 	DECLARE_LUA_OPCODE(LockSet);
 	DECLARE_LUA_OPCODE(UnLockSet);
 	DECLARE_LUA_OPCODE(MakeCurrentSet);
+	DECLARE_LUA_OPCODE(PreloadSet);
 	DECLARE_LUA_OPCODE(MakeCurrentSetup);
 	DECLARE_LUA_OPCODE(GetCurrentSetup);
 	DECLARE_LUA_OPCODE(ShrinkBoxes);
@@ -42,6 +42,8 @@ MaterialData::MaterialData(const Common::String &filename, Common::SeekableReadS
 	} else {
 		initGrim(filename, data, cmap);
 	}
+	for (int i = 0; i < _numImages; ++i)
+		_textures[i]._materialData = this;
 }
 
 void MaterialData::initGrim(const Common::String &filename, Common::SeekableReadStream *data, CMap *cmap) {
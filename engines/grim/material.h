@@ -28,6 +28,7 @@
 namespace Grim {
 
 class CMap;
+class MaterialData;
 
 class Texture {
 public:
@@ -38,6 +39,8 @@ public:
 	bool _hasAlpha;
 	void *_texture;
 	char *_data;
+	// the material this is an image of
+	MaterialData *_materialData;
 };
 
 class MaterialData {
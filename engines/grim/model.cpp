@@ -54,7 +54,7 @@ Model::Model(const Common::String &filename, Common::SeekableReadStream *data, C
 		loadBinary(data, cmap);
 	else {
 		data->seek(0, SEEK_SET);
-		TextSplitter ts(data);
+		TextSplitter ts(_fname, data);
 		loadText(&ts, cmap);
 	}
 	delete data;
@@ -392,6 +392,7 @@ void MeshFace::draw(float *vertices, float *vertNormals, float *textureVerts) co
  * @class Mesh
  */
 Mesh::~Mesh() {
+	g_driver->destroyMesh(this);
 	delete[] _vertices;
 	delete[] _verticesI;
 	delete[] _vertNormals;
@@ -440,6 +441,9 @@ void Mesh::loadBinary(Common::SeekableReadStream *data, Material *materials[]) {
 	data->read(f, 4);
 	_radius = get_float(f);
 	data->seek(24, SEEK_CUR);
+
+	computeBounds();
+	g_driver->createMesh(this);
 }
 
 void Mesh::loadText(TextSplitter *ts, Material* materials[]) {
@@ -447,7 +451,7 @@ void Mesh::loadText(TextSplitter *ts, Material* materials[]) {
 	ts->scanString("radius %f", 1, &_radius);
 
 	// In data001/rope_scale.3do, the shadow line is missing
-	if (sscanf(ts->getCurrentLine(), "shadow %d", &_shadow) < 1) {
+	if (ts->scanCurrentLine(0, "shadow %d", &_shadow) < 1) {
 		_shadow = 0;
 	} else
 		ts->nextLine();
@@ -502,7 +506,7 @@ void Mesh::loadText(TextSplitter *ts, Material* materials[]) {
 		if (ts->isEof())
 			error("Expected face data, got EOF");
 
-		if (sscanf(ts->getCurrentLine(), " %d: %d %x %d %d %d %f %d%n", &num, &materialid, &type, &geo, &light, &tex, &extralight, &verts, &readlen) < 8)
+		if (ts->scanCurrentLine(0, " %d: %d %x %d %d %d %f %d%n", &num, &materialid, &type, &geo, &light, &tex, &extralight, &verts, &readlen) < 8)
 			error("Expected face data, got '%s'", ts->getCurrentLine());
 
 		assert(materialid != -1);
@@ -519,7 +523,7 @@ void Mesh::loadText(TextSplitter *ts, Material* materials[]) {
 		for (int j = 0; j < verts; j++) {
 			int readlen2;
 
-			if (sscanf(ts->getCurrentLine() + readlen, " %d, %d%n", &_faces[num]._vertices[j], &_faces[num]._texVertices[j], &readlen2) < 2)
+			if (ts->scanCurrentLine(readlen, " %d, %d%n", &_faces[num]._vertices[j], &_faces[num]._texVertices[j], &readlen2) < 2)
 				error("Could not read vertex indices in line '%s'",
 
 			ts->getCurrentLine());
@@ -535,30 +539,76 @@ void Mesh::loadText(TextSplitter *ts, Material* materials[]) {
 		ts->scanString(" %d: %f %f %f", 4, &num, &x, &y, &z);
 		_faces[num]._normal = Math::Vector3d(x, y, z);
 	}
+
+	computeBounds();
+	g_driver->createMesh(this);
 }
 
 void Mesh::update() {
 }
 
+void Mesh::computeBounds() {
+	if (_numVertices == 0) {
+		_boundingBoxMin.set(0, 0, 0);
+		_boundingBoxMax.set(0, 0, 0);
+		_boundingCenter.set(0, 0, 0);
+		_boundingRadius = 0.f;
+		return;
+	}
+
+	float min[3], max[3];
+	for (int j = 0; j < 3; j++)
+		min[j] = max[j] = _vertices[j];
+	for (int i = 1; i < _numVertices; i++) {
+		for (int j = 0; j < 3; j++) {
+			min[j] = MIN(min[j], _vertices[3 * i + j]);
+			max[j] = MAX(max[j], _vertices[3 * i + j]);
+		}
+	}
+	_boundingBoxMin.set(min[0], min[1], min[2]);
+	_boundingBoxMax.set(max[0], max[1], max[2]);
+
+	// the sphere is centered on the box, reaching the farthest vertex
+	_boundingCenter = (_boundingBoxMin + _boundingBoxMax) / 2.f;
+
+	_boundingRadius = 0.f;
+	for (int i = 0; i < _numVertices; i++) {
+		Math::Vector3d v(_vertices[3 * i], _vertices[3 * i + 1], _vertices[3 * i + 2]);
+		_boundingRadius = MAX(_boundingRadius, (v - _boundingCenter).getMagnitude());
+	}
+}
+
 void Mesh::changeMaterials(Material *materials[]) {
 	for (int i = 0; i < _numFaces; i++)
 		_faces[i].changeMaterial(materials[_materialid[i]]);
+
+	// the renderer may have laid out the mesh with the old materials
+	g_driver->destroyMesh(this);
+	g_driver->createMesh(this);
 }
 
 void Mesh::draw() const {
 	if (_lightingMode == 0)
 		g_driver->disableLights();
 
-	for (int i = 0; i < _numFaces; i++)
-		_faces[i].draw(_vertices, _vertNormals, _textureVerts);
+	g_driver->drawMesh(this);
 
 	if (_lightingMode == 0)
 		g_driver->enableLights();
 }
 
-void Mesh::getBoundingBox(int *x1, int *y1, int *x2, int *y2) const {
+void Mesh::getBoundingBox(const Math::Matrix4 &matrix, int *x1, int *y1, int *x2, int *y2) const {
+	// the corners of the box, in world coordinates
+	Math::Vector3d corners[8];
+	for (int i = 0; i < 8; i++) {
+		corners[i].set((i & 1) ? _boundingBoxMax.x() : _boundingBoxMin.x(),
+					   (i & 2) ? _boundingBoxMax.y() : _boundingBoxMin.y(),
+					   (i & 4) ? _boundingBoxMax.z() : _boundingBoxMin.z());
+		matrix.transform(&corners[i], true);
+	}
+
 	int winX1, winY1, winX2, winY2;
-	g_driver->getBoundingBoxPos(this, &winX1, &winY1, &winX2, &winY2);
+	g_driver->getBoundingBoxPos(corners, 8, &winX1, &winY1, &winX2, &winY2);
 	if (winX1 != -1 && winY1 != -1 && winX2 != -1 && winY2 != -1) {
 		*x1 = MIN(*x1, winX1);
 		*y1 = MIN(*y1, winY1);
@@ -634,7 +684,8 @@ void ModelNode::loadBinary(Common::SeekableReadStream *data, ModelNode *hierNode
 
 void ModelNode::draw() const {
 	translateViewpoint();
-	if (_hierVisible) {
+	// nothing of the node and its children shows when their bounds don't
+	if (_hierVisible && (_boundingRadius < 0 || g_driver->isSphereVisible(_boundingCenter, _boundingRadius))) {
 		g_driver->translateViewpointStart();
 		g_driver->translateViewpoint(_pivot);
 
@@ -646,7 +697,7 @@ void ModelNode::draw() const {
 			}
 		}
 
-		if (_mesh && _meshVisible) {
+		if (_mesh && _meshVisible && isMeshVisible()) {
 			_mesh->draw();
 		}
 
@@ -663,26 +714,23 @@ void ModelNode::draw() const {
 	}
 }
 
-void ModelNode::getBoundingBox(int *x1, int *y1, int *x2, int *y2) const {
-	translateViewpoint();
+// The matrix places the parent node, the nodes' own matrices are left alone
+void ModelNode::getBoundingBox(const Math::Matrix4 &matrix, int *x1, int *y1, int *x2, int *y2) const {
 	if (_hierVisible) {
-		g_driver->translateViewpointStart();
-		g_driver->translateViewpoint(_pivot);
-
+		Math::Matrix4 nodeMatrix = matrix * getLocalMatrix();
 		if (_mesh && _meshVisible) {
-			_mesh->getBoundingBox(x1, y1, x2, y2);
+			Math::Matrix4 pivotMatrix = nodeMatrix;
+			pivotMatrix.translate(_pivot);
+			_mesh->getBoundingBox(pivotMatrix, x1, y1, x2, y2);
 		}
 
-		g_driver->translateViewpointFinish();
-
 		if (_child) {
-			_child->getBoundingBox(x1, y1, x2, y2);
+			_child->getBoundingBox(nodeMatrix, x1, y1, x2, y2);
 		}
 	}
-	translateViewpointBack();
 
 	if (_sibling) {
-		_sibling->getBoundingBox(x1, y1, x2, y2);
+		_sibling->getBoundingBox(matrix, x1, y1, x2, y2);
 	}
 }
 
@@ -715,14 +763,7 @@ void ModelNode::update() {
 		return;
 
 	if (_hierVisible) {
-		Math::Vector3d animPos = _pos + _animPos;
-		Math::Angle animPitch = _pitch + _animPitch;
-		Math::Angle animYaw = _yaw + _animYaw;
-		Math::Angle animRoll = _roll + _animRoll;
-
-		_localMatrix.setPosition(animPos);
-		_localMatrix.buildFromPitchYawRoll(animPitch, animYaw, animRoll);
-
+		_localMatrix = getLocalMatrix();
 		_matrix = _matrix * _localMatrix;
 
 		_pivotMatrix = _matrix;
@@ -743,6 +784,88 @@ void ModelNode::update() {
 	}
 }
 
+// Computes the bounds used to cull the nodes, the matrix placing the parent
+// node. Like getBoundingBox(), it leaves the nodes' own matrices alone.
+void ModelNode::updateBounds(const Math::Matrix4 &matrix) {
+	if (!_initialized)
+		return;
+
+	if (_hierVisible) {
+		Math::Matrix4 nodeMatrix = matrix * getLocalMatrix();
+		Math::Matrix4 pivotMatrix = nodeMatrix;
+		pivotMatrix.translate(_pivot);
+
+		if (_child) {
+			_child->updateBounds(nodeMatrix);
+		}
+
+		// the children are up to date, their bounds enclose the node's
+		_boundingCenter = pivotMatrix.getPosition();
+		_boundingRadius = 0.f;
+		bool known = true;
+		if (_mesh && _meshVisible) {
+			_meshBoundingCenter = _mesh->_boundingCenter;
+			pivotMatrix.transform(&_meshBoundingCenter, true);
+			addBoundingSphere(_meshBoundingCenter, _mesh->_boundingRadius);
+		}
+		for (Sprite *sprite = _sprite; sprite; sprite = sprite->_next) {
+			Math::Vector3d center = sprite->_pos;
+			pivotMatrix.transform(&center, true);
+			addBoundingSphere(center, sprite->_width + sprite->_height);
+		}
+		for (ModelNode *child = _child; child; child = child->_sibling) {
+			if (!child->_hierVisible)
+				continue;
+			if (child->_boundingRadius < 0)
+				known = false;
+			else
+				addBoundingSphere(child->_boundingCenter, child->_boundingRadius);
+		}
+		if (!known)
+			_boundingRadius = -1.f;
+	}
+
+	if (_sibling) {
+		_sibling->updateBounds(matrix);
+	}
+}
+
+void ModelNode::addBoundingSphere(const Math::Vector3d &center, float radius) {
+	Math::Vector3d offset = center - _boundingCenter;
+	float distance = offset.getMagnitude();
+	if (distance + radius <= _boundingRadius)
+		return;
+	if (distance + _boundingRadius <= radius) {
+		_boundingCenter = center;
+		_boundingRadius = radius;
+		return;
+	}
+
+	float newRadius = (distance + _boundingRadius + radius) / 2;
+	_boundingCenter += offset * ((newRadius - _boundingRadius) / distance);
+	_boundingRadius = newRadius;
+}
+
+bool ModelNode::isMeshVisible() const {
+	if (_boundingRadius < 0)
+		return true;
+
+	return g_driver->isSphereVisible(_meshBoundingCenter, _mesh->_boundingRadius);
+}
+
+// The transformation from the node to its parent, the pivot aside
+Math::Matrix4 ModelNode::getLocalMatrix() const {
+	Math::Vector3d animPos = _pos + _animPos;
+	Math::Angle animPitch = _pitch + _animPitch;
+	Math::Angle animYaw = _yaw + _animYaw;
+	Math::Angle animRoll = _roll + _animRoll;
+
+	Math::Matrix4 matrix;
+	matrix.setPosition(animPos);
+	matrix.buildFromPitchYawRoll(animPitch, animYaw, animRoll);
+	return matrix;
+}
+
 void ModelNode::addSprite(Sprite *sprite) {
 	sprite->_next = _sprite;
 	_sprite = sprite;
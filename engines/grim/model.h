@@ -118,9 +118,10 @@ public:
 	void loadText(TextSplitter *ts, Material *materials[]);
 	void changeMaterials(Material *materials[]);
 	void draw() const;
-	void getBoundingBox(int *x1, int *y1, int *x2, int *y2) const;
+	void getBoundingBox(const Math::Matrix4 &matrix, int *x1, int *y1, int *x2, int *y2) const;
 	void update();
-	Mesh() : _numFaces(0) { }
+	void computeBounds();
+	Mesh() : _numFaces(0), _userData(NULL) { }
 	~Mesh();
 
 	char _name[32];
@@ -139,19 +140,30 @@ public:
 	int _numFaces;
 	MeshFace *_faces;
 	Math::Matrix4 _matrix;
+	// enclose the vertices, in the coordinates of the mesh
+	Math::Vector3d _boundingBoxMin, _boundingBoxMax;
+	Math::Vector3d _boundingCenter;
+	float _boundingRadius;
+
+	// the renderer's representation of the mesh
+	void *_userData;
 };
 
 class ModelNode {
 public:
-	ModelNode() : _initialized(false) { }
+	ModelNode() : _initialized(false), _boundingRadius(-1.f) { }
 	~ModelNode();
 	void loadBinary(Common::SeekableReadStream *data, ModelNode *hierNodes, const Model::Geoset *g);
 	void draw() const;
-	void getBoundingBox(int *x1, int *y1, int *x2, int *y2) const;
+	void getBoundingBox(const Math::Matrix4 &matrix, int *x1, int *y1, int *x2, int *y2) const;
 	void addChild(ModelNode *child);
 	void removeChild(ModelNode *child);
 	void setMatrix(Math::Matrix4 matrix);
 	void update();
+	void updateBounds(const Math::Matrix4 &matrix);
+	Math::Matrix4 getLocalMatrix() const;
+	void addBoundingSphere(const Math::Vector3d &center, float radius);
+	bool isMeshVisible() const;
 	void addSprite(Sprite *sprite);
 	void removeSprite(Sprite *sprite);
 	void translateViewpoint() const;
@@ -183,6 +195,14 @@ public:
 	Math::Matrix4 _localMatrix;
 	Math::Matrix4 _pivotMatrix;
 	Sprite* _sprite;
+	/**
+	 * Encloses what the node and its children draw, in world coordinates.
+	 * Computed by updateBounds(), a negative radius when unknown.
+	 */
+	Math::Vector3d _boundingCenter;
+	float _boundingRadius;
+	// The center of the mesh's sphere, in world coordinates
+	Math::Vector3d _meshBoundingCenter;
 };
 
 } // end of namespace Grim
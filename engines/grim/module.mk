@@ -62,8 +62,10 @@ MODULE_OBJS := \
 	color.o \
 	colormap.o \
 	debug.o \
+	debugger.o \
 	detection.o \
 	font.o \
+	framepacer.o \
 	gfx_base.o \
 	gfx_opengl.o \
 	gfx_tinygl.o \
@@ -73,6 +75,7 @@ MODULE_OBJS := \
 	iris.o \
 	keyframe.o \
 	lab.o \
+	labindex.o \
 	lipsync.o \
 	localize.o \
 	lua.o \
@@ -88,6 +91,7 @@ MODULE_OBJS := \
 	objectstate.o \
 	primitives.o \
 	patchr.o \
+	profiler.o \
 	registry.o \
 	resource.o \
 	savegame.o \
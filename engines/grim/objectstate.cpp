@@ -29,6 +29,8 @@
 
 namespace Grim {
 
+uint ObjectState::s_changeCount = 0;
+
 ObjectState::ObjectState(int setup, ObjectState::Position position, const char *bitmap, const char *zbitmap, bool transparency) :
 		PoolObject<ObjectState, MKTAG('S', 'T', 'A', 'T')>(), _setupID(setup), _pos(position), _visibility(false) {
 
@@ -37,6 +39,7 @@ ObjectState::ObjectState(int setup, ObjectState::Position position, const char *
 		_zbitmap = g_resourceloader->loadBitmap(zbitmap);
 	} else
 		_zbitmap = NULL;
+	flagChanged();
 }
 
 ObjectState::ObjectState() :
@@ -47,13 +50,24 @@ ObjectState::ObjectState() :
 ObjectState::~ObjectState() {
 	delete _bitmap;
 	delete _zbitmap;
+	flagChanged();
 }
 
 const Common::String &ObjectState::getBitmapFilename() const {
 	return _bitmap->getFilename();
 }
 
+void ObjectState::setPos(Position position) {
+	if (position != _pos)
+		flagChanged();
+	_pos = position;
+}
+
 void ObjectState::setActiveImage(int val) {
+	// chores keep setting the image they already set
+	if (val != (_visibility && _bitmap ? _bitmap->getActiveImage() : 0))
+		flagChanged();
+
 	if (val) {
 		assert(_bitmap);
 		_bitmap->setActiveImage(val);
@@ -102,6 +116,7 @@ bool ObjectState::restoreState(SaveGame *savedState) {
 
 	_bitmap = Bitmap::getPool().getObject(savedState->readLESint32());
 	_zbitmap = Bitmap::getPool().getObject(savedState->readLESint32());
+	flagChanged();
 
 	return true;
 }
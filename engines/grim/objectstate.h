@@ -48,14 +48,24 @@ public:
 
 	int getSetupID() const { return _setupID; }
 	Position getPos() const { return _pos; }
-	void setPos(Position position) { _pos = position; }
+	void setPos(Position position);
 
 	const Common::String &getBitmapFilename() const;
 
 	void setActiveImage(int val);
 	void draw();
 
+	/**
+	 * Bumped whenever an object state changes what it draws, or its place
+	 * in the drawing order. While it stays the same a composited background
+	 * is still valid.
+	 */
+	static uint getChangeCount() { return s_changeCount; }
+	static void flagChanged() { s_changeCount++; }
+
 private:
+	static uint s_changeCount;
+
 	bool _visibility;
 	int _setupID;
 	Position _pos;
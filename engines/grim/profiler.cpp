@@ -0,0 +1,196 @@
+/* ResidualVM - A 3D game interpreter
+ *
+ * ResidualVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ *
+ */
+
+#include "common/algorithm.h"
+#include "common/config-manager.h"
+#include "common/fs.h"
+
+#include "engines/grim/profiler.h"
+#include "engines/grim/framepacer.h"
+#include "engines/grim/gfx_base.h"
+#include "engines/grim/color.h"
+
+namespace Grim {
+
+static const char *const phaseNames[] = {
+	"imuse",
+	"events",
+	"lua_tasks",
+	"actor_updates",
+	"text_updates",
+	"background",
+	"bitmaps",
+	"movie",
+	"actors",
+	"overlays",
+	"flip",
+	"frame"
+};
+
+Profiler::Profiler() :
+		_trace(false), _traceEvents(0), _frameStart(0), _frameNumber(0), _depth(0), _resumed(0),
+		_windowFrames(0), _lastPercentiles(0) {
+	memset(_times, 0, sizeof(_times));
+	memset(_percentiles, 0, sizeof(_percentiles));
+
+	_show = ConfMan.getBool("show_frame_times");
+
+	Common::String logName = ConfMan.get("frame_times_log");
+	if (!logName.empty()) {
+		if (!_log.open(Common::FSNode(logName))) {
+			warning("Could not open the frame times log %s", logName.c_str());
+		} else if (logName.hasSuffix(".json")) {
+			_trace = true;
+			_log.writeString("[\n");
+		} else {
+			// the times are in microseconds
+			_log.writeString("frame_number");
+			for (int i = 0; i <= NumPhases; i++)
+				_log.writeString(Common::String::format(",%s", phaseNames[i]));
+			_log.writeString("\n");
+		}
+	}
+
+	_enabled = _show || _log.isOpen();
+}
+
+Profiler::~Profiler() {
+	if (_trace)
+		_log.writeString("\n]\n");
+	_log.close();
+}
+
+void Profiler::beginFrame() {
+	if (!_enabled)
+		return;
+
+	_frameStart = FramePacer::getMicros();
+	_depth = 0;
+	memset(_times, 0, sizeof(_times));
+}
+
+void Profiler::begin(Phase phase) {
+	if (!_enabled)
+		return;
+
+	assert(_depth < kMaxDepth);
+	uint64 now = FramePacer::getMicros();
+	// the enclosing phase waits for this one
+	if (_depth > 0)
+		_times[_stack[_depth - 1]] += (uint32)(now - _resumed);
+	_stack[_depth] = phase;
+	_stackStart[_depth] = now;
+	_depth++;
+	_resumed = now;
+}
+
+void Profiler::end() {
+	if (!_enabled)
+		return;
+
+	assert(_depth > 0);
+	uint64 now = FramePacer::getMicros();
+	_depth--;
+	Phase phase = _stack[_depth];
+	_times[phase] += (uint32)(now - _resumed);
+	_resumed = now;
+
+	// the slices of the trace include the phases inside them
+	if (_trace) {
+		writeTraceEvent(Common::String::format("{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":0,\"ts\":%.0f,\"dur\":%.0f}",
+											   phaseNames[phase], (double)_stackStart[_depth], (double)(now - _stackStart[_depth])));
+	}
+}
+
+void Profiler::endFrame() {
+	if (!_enabled)
+		return;
+
+	uint64 now = FramePacer::getMicros();
+	_times[NumPhases] = (uint32)(now - _frameStart);
+
+	memcpy(_window[_frameNumber % kWindowFrames], _times, sizeof(_times));
+	if (_windowFrames < kWindowFrames)
+		_windowFrames++;
+
+	if (_log.isOpen())
+		writeLog();
+	_frameNumber++;
+}
+
+void Profiler::writeLog() {
+	if (_trace) {
+		writeTraceEvent(Common::String::format("{\"name\":\"frame\",\"ph\":\"X\",\"pid\":0,\"tid\":0,\"ts\":%.0f,\"dur\":%u,\"args\":{\"frame_number\":%u}}",
+											   (double)_frameStart, _times[NumPhases], _frameNumber));
+		return;
+	}
+
+	Common::String line = Common::String::format("%u", _frameNumber);
+	for (int i = 0; i <= NumPhases; i++)
+		line += Common::String::format(",%u", _times[i]);
+	line += "\n";
+	_log.writeString(line);
+}
+
+// Chrome reads a trace with no closing bracket, as long as it ends with a
+// complete event: the separators go before the events
+void Profiler::writeTraceEvent(const Common::String &event) {
+	if (_traceEvents++ > 0)
+		_log.writeString(",\n");
+	_log.writeString(event);
+}
+
+void Profiler::computePercentiles() {
+	uint32 values[kWindowFrames];
+	for (int i = 0; i <= NumPhases; i++) {
+		for (int f = 0; f < _windowFrames; f++)
+			values[f] = _window[f][i];
+		Common::sort(values, values + _windowFrames);
+		_percentiles[i][0] = values[(_windowFrames - 1) * 50 / 100];
+		_percentiles[i][1] = values[(_windowFrames - 1) * 95 / 100];
+		_percentiles[i][2] = values[(_windowFrames - 1) * 99 / 100];
+	}
+}
+
+void Profiler::draw() {
+	if (!_show || _windowFrames == 0)
+		return;
+
+	// sorting every frame would show up in the times
+	uint64 now = FramePacer::getMicros();
+	if (now - _lastPercentiles > 500000) {
+		computePercentiles();
+		_lastPercentiles = now;
+	}
+
+	const Color color(255, 255, 255);
+	int y = 25;
+	g_driver->drawEmergString(10, y, "ms              p50    p95    p99", color);
+	for (int i = 0; i <= NumPhases; i++) {
+		y += 14;
+		Common::String line = Common::String::format("%-13s %6.2f %6.2f %6.2f", phaseNames[i],
+													 _percentiles[i][0] / 1000.f, _percentiles[i][1] / 1000.f, _percentiles[i][2] / 1000.f);
+		g_driver->drawEmergString(10, y, line.c_str(), color);
+	}
+}
+
+} // end of namespace Grim
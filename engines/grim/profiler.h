@@ -0,0 +1,106 @@
+/* ResidualVM - A 3D game interpreter
+ *
+ * ResidualVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ *
+ */
+
+#ifndef GRIM_PROFILER_H
+#define GRIM_PROFILER_H
+
+#include "common/file.h"
+#include "common/str.h"
+
+namespace Grim {
+
+/**
+ * Times the phases of the frames of the main loop.
+ *
+ * The time of a phase doesn't count the phases begun inside it. The last
+ * frames are kept to give the percentiles of every phase, which can be
+ * shown over the game. Every frame can also be written to a log: a CSV
+ * file with a line per frame, or, when the file name ends with ".json",
+ * a trace for Chrome's about:tracing with a slice per phase.
+ */
+class Profiler {
+public:
+	enum Phase {
+		IMuse,
+		Events,
+		LuaTasks,
+		ActorUpdates,
+		TextUpdates,
+		Background,
+		Bitmaps,
+		Movie,
+		Actors,
+		Overlays,
+		Flip,
+		NumPhases
+	};
+
+	Profiler();
+	~Profiler();
+
+	bool isEnabled() const { return _enabled; }
+
+	void beginFrame();
+	void endFrame();
+	void begin(Phase phase);
+	void end();
+
+	/** Draws the percentiles of the phases over the screen */
+	void draw();
+
+private:
+	enum {
+		kWindowFrames = 120,
+		kMaxDepth = 8
+	};
+
+	void writeLog();
+	void writeTraceEvent(const Common::String &event);
+	void computePercentiles();
+
+	bool _enabled;
+	bool _show;
+	bool _trace;
+	uint32 _traceEvents;
+	Common::DumpFile _log;
+
+	uint64 _frameStart;
+	uint32 _frameNumber;
+	// the phases begun and not ended yet, the innermost last
+	Phase _stack[kMaxDepth];
+	uint64 _stackStart[kMaxDepth];
+	int _depth;
+	uint64 _resumed;
+
+	// the time of every phase in this frame, the whole frame last
+	uint32 _times[NumPhases + 1];
+	// the same for the last frames, in a ring
+	uint32 _window[kWindowFrames][NumPhases + 1];
+	int _windowFrames;
+	// p50, p95 and p99 of each phase, refreshed now and then
+	uint32 _percentiles[NumPhases + 1][3];
+	uint64 _lastPercentiles;
+};
+
+} // end of namespace Grim
+
+#endif
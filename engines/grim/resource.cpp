@@ -29,21 +29,93 @@
 #include "engines/grim/lipsync.h"
 #include "engines/grim/savegame.h"
 #include "engines/grim/lab.h"
+#include "engines/grim/labindex.h"
 #include "engines/grim/bitmap.h"
 #include "engines/grim/font.h"
+#include "engines/grim/framepacer.h"
 #include "engines/grim/model.h"
 #include "engines/grim/modelemi.h"
 #include "engines/grim/skeleton.h"
 #include "engines/grim/inputdialog.h"
 #include "engines/grim/debug.h"
 #include "engines/grim/patchr.h"
+#include "engines/grim/textsplit.h"
+#include "engines/grim/lua.h"
+#include "engines/grim/lua/luadebug.h"
 #include "common/algorithm.h"
+#include "common/config-manager.h"
+#include "common/savefile.h"
+#include "common/system.h"
 #include "gui/message.h"
 
 namespace Grim {
 
 ResourceLoader *g_resourceloader = NULL;
 
+// Default budget of the resource cache, overridable with the
+// "resource_cache_size" config key (in KB, 0 disables the limit)
+static const int32 kDefaultCacheMemoryBudget = 32 * 1024 * 1024;
+// The cache size is kept in an int32, larger settings are clamped to this
+static const int32 kMaxCacheMemoryBudget = 1024 * 1024 * 1024;
+
+// The prefetch reads up to this many bytes per frame
+static const uint32 kPrefetchBytesPerFrame = 256 * 1024;
+
+struct ResourceBufferDeleter {
+	void operator()(byte *buf) { delete[] buf; }
+};
+
+/**
+ * A MemoryReadStream over a cached resource. It holds a reference to the
+ * buffer, so that the resource can be evicted from the cache while the
+ * stream is still being read.
+ */
+class CachedResourceStream : public Common::MemoryReadStream {
+public:
+	CachedResourceStream(const Common::SharedPtr<byte> &buf, uint32 len) :
+		Common::MemoryReadStream(buf.get(), len), _buf(buf) { }
+
+private:
+	Common::SharedPtr<byte> _buf;
+};
+
+// The merged directory of the archives, see LabIndex
+static Common::String getLabIndexName() {
+	return g_grim->getGameType() == GType_MONKEY4 ? "monkey4-labs.idx" : "grim-labs.idx";
+}
+
+static bool loadLabIndex(LabIndex *index, const LabIndex::StampList &stamps) {
+	Common::InSaveFile *in = g_system->getSavefileManager()->openForLoading(getLabIndexName());
+	if (!in)
+		return false;
+
+	bool success = index->load(in, stamps);
+	delete in;
+	return success;
+}
+
+static void saveLabIndex(const LabIndex *index) {
+	Common::OutSaveFile *out = g_system->getSavefileManager()->openForSaving(getLabIndexName());
+	if (!out) {
+		warning("Could not write the archive index %s", getLabIndexName().c_str());
+		return;
+	}
+
+	index->save(out);
+	out->finalize();
+	if (out->err())
+		warning("Could not write the archive index %s", getLabIndexName().c_str());
+	delete out;
+}
+
+// The compiled forms of the text resources, see TextSplitter
+#define COMPILEDTEXT_TAG	MKTAG('C','T','X','T')
+static const uint32 kMaxCompiledTextsSize = 8 * 1024 * 1024;
+
+static Common::String getCompiledTextName() {
+	return g_grim->getGameType() == GType_MONKEY4 ? "monkey4-compiled.cache" : "grim-compiled.cache";
+}
+
 class LabListComperator {
 	const Common::String _labName;
 public:
@@ -60,8 +132,26 @@ public:
 };
 
 ResourceLoader::ResourceLoader() {
-	_cacheDirty = false;
 	_cacheMemorySize = 0;
+	_cacheMemoryBudget = kDefaultCacheMemoryBudget;
+	if (ConfMan.hasKey("resource_cache_size")) {
+		uint64 budget = (uint64)MAX(ConfMan.getInt("resource_cache_size"), 0) * 1024;
+		_cacheMemoryBudget = (int32)MIN<uint64>(budget, kMaxCacheMemoryBudget);
+	}
+	_cacheHits = 0;
+	_cacheMisses = 0;
+	_cacheEvictions = 0;
+	_compiledTextsSize = 0;
+	_compiledTextsClock = 0;
+	_compiledTextsLoaded = false;
+	_compiledTextsDirty = false;
+	_profiling = false;
+	_currentProfile = NULL;
+	_tracing = ConfMan.hasKey("resource_trace") && ConfMan.getBool("resource_trace");
+	_prefetchStream = NULL;
+	_prefetchData = NULL;
+	_prefetchSize = 0;
+	_prefetchRead = 0;
 
 	Lab *l;
 	Common::ArchiveMemberList files;
@@ -108,14 +198,55 @@ ResourceLoader::ResourceLoader() {
 	if (files.empty())
 		error("Cannot find game data - check configuration file");
 
-	int priority = files.size();
-	for (Common::ArchiveMemberList::const_iterator x = files.begin(); x != files.end(); ++x) {
-		Common::String filename = (*x)->getName();
-		filename.toLowercase();
+	LabIndex::StampList stamps;
+	bool stamped = true;
+	for (Common::ArchiveMemberList::const_iterator x = files.begin(); x != files.end() && stamped; ++x) {
+		LabIndex::Stamp stamp;
+		stamp.name = (*x)->getName();
+		stamp.name.toLowercase();
+		stamped = Lab::getArchiveStamp(stamp.name, stamp.size, stamp.hash);
+		stamps.push_back(stamp);
+	}
+
+	if (stamped) {
+		// All the archives are looked up through one merged directory, which
+		// is only made again when they changed
+		LabIndex *index = new LabIndex();
+		if (!loadLabIndex(index, stamps)) {
+			Common::Array<Lab *> labs;
+			for (LabIndex::StampList::const_iterator i = stamps.begin(); i != stamps.end(); ++i) {
+				l = new Lab();
+				if (!l->open(i->name)) {
+					delete l;
+					l = NULL;
+				}
+				labs.push_back(l);
+			}
+			index->build(stamps, labs);
+			saveLabIndex(index);
+		}
+		_files.add("labs", index, files.size(), true);
+	} else {
+		// Some archive couldn't be stamped, its index couldn't be trusted
+		int priority = files.size();
+		for (Common::ArchiveMemberList::const_iterator x = files.begin(); x != files.end(); ++x) {
+			Common::String filename = (*x)->getName();
+			filename.toLowercase();
+
+			l = new Lab();
+			if (l->open(filename))
+				_files.add(filename, l, priority--, true);
+			else
+				delete l;
+		}
+	}
 
+	// A packed archive takes precedence over the archives it was made from
+	Common::String packedName = getPackedArchiveName();
+	if (SearchMan.hasFile(packedName)) {
 		l = new Lab();
-		if (l->open(filename))
-			_files.add(filename, l, priority--, true);
+		if (l->open(packedName))
+			_files.add(packedName, l, files.size() + 1, true);
 		else
 			delete l;
 	}
@@ -128,38 +259,66 @@ ResourceLoader::ResourceLoader() {
 void ResourceLoader::loadPatches() {
 	Common::ArchiveMemberList patches;
 	_patches.clear();
+	_patchedFiles.clear();
 	_files.listMatchingMembers(patches, "*.patchr");
 	SearchMan.listMatchingMembers(patches, "*.patchr");
 	for (Common::ArchiveMemberList::const_iterator x = patches.begin(); x != patches.end(); ++x) {
 		Common::String filename = (*x)->getName();
 		filename = Common::String(filename.c_str(), filename.size() - 7); //remove the .patchr extension
-		_patches.push_back(filename);
+		_patches[filename] = true;
 	}
 }
 
 template<typename T>
-void clearList(Common::List<T> &list) {
-	while (!list.empty()) {
-		T p = list.front();
-		list.erase(list.begin());
-		delete p;
-	}
+void addToIndex(Common::HashMap<Common::String, Common::List<T *> > &index, const Common::String &key, T *p) {
+	index[key].push_back(p);
 }
 
-ResourceLoader::~ResourceLoader() {
-	for (Common::Array<ResourceCache>::iterator i = _cache.begin(); i != _cache.end(); ++i) {
-		ResourceCache &r = *i;
-		delete[] r.fname;
-		delete[] r.resPtr;
+template<typename T>
+void removeFromIndex(Common::HashMap<Common::String, Common::List<T *> > &index, const Common::String &key, T *p) {
+	typename Common::HashMap<Common::String, Common::List<T *> >::iterator i = index.find(key);
+	if (i == index.end())
+		return;
+
+	i->_value.remove(p);
+	if (i->_value.empty())
+		index.erase(i);
+}
+
+template<typename T>
+T *findInIndex(const Common::HashMap<Common::String, Common::List<T *> > &index, const Common::String &key) {
+	typename Common::HashMap<Common::String, Common::List<T *> >::const_iterator i = index.find(key);
+	if (i == index.end())
+		return NULL;
+
+	return i->_value.front();
+}
+
+template<typename T>
+void clearIndex(Common::HashMap<Common::String, Common::List<T *> > &index) {
+	while (!index.empty()) {
+		typename Common::HashMap<Common::String, Common::List<T *> >::iterator i = index.begin();
+		T *p = i->_value.front();
+		i->_value.pop_front();
+		if (i->_value.empty())
+			index.erase(i);
+		// The destructor calls uncache*(), which won't find it anymore
+		delete p;
 	}
-	clearList(_models);
-	clearList(_colormaps);
-	clearList(_keyframeAnims);
-	clearList(_lipsyncs);
 }
 
-static int sortCallback(const void *entry1, const void *entry2) {
-	return scumm_stricmp(((ResourceLoader::ResourceCache *)entry1)->fname, ((ResourceLoader::ResourceCache *)entry2)->fname);
+ResourceLoader::~ResourceLoader() {
+	delete _prefetchStream;
+	delete[] _prefetchData;
+	_cache.clear();
+	_cacheLRU.clear();
+	clearIndex(_models);
+	clearIndex(_colormaps);
+	clearIndex(_keyframeAnims);
+	clearIndex(_lipsyncs);
+	// Not written while playing, so that set changes don't wait on the disk
+	if (_compiledTextsDirty)
+		saveCompiledTexts();
 }
 
 Common::SeekableReadStream *ResourceLoader::getFileFromCache(const Common::String &filename) {
@@ -167,23 +326,178 @@ Common::SeekableReadStream *ResourceLoader::getFileFromCache(const Common::Strin
 	if (!entry)
 		return NULL;
 
-	return new Common::MemoryReadStream(entry->resPtr, entry->len);
-
+	return new CachedResourceStream(entry->resPtr, entry->len);
 }
 
 ResourceLoader::ResourceCache *ResourceLoader::getEntryFromCache(const Common::String &filename) {
-	if (_cache.empty())
+	ResourceCacheMap::iterator it = _cache.find(filename);
+	if (it == _cache.end())
 		return NULL;
 
-	if (_cacheDirty) {
-		qsort(_cache.begin(), _cache.size(), sizeof(ResourceCache), sortCallback);
-		_cacheDirty = false;
+	// Move the entry to the front of the LRU list
+	ResourceCache &entry = it->_value;
+	_cacheLRU.erase(entry.lruPos);
+	_cacheLRU.push_front(filename);
+	entry.lruPos = _cacheLRU.begin();
+
+	return &entry;
+}
+
+void ResourceLoader::loadCompiledTexts() {
+	_compiledTextsLoaded = true;
+
+	Common::InSaveFile *in = g_system->getSavefileManager()->openForLoading(getCompiledTextName());
+	if (!in)
+		return;
+
+	if (in->readUint32BE() != COMPILEDTEXT_TAG || in->readUint32LE() != TextSplitter::kCompiledTextVersion) {
+		// Compiled by an older version, it will be overwritten
+		_compiledTextsDirty = true;
+		delete in;
+		return;
+	}
+
+	uint32 count = in->readUint32LE();
+	for (uint32 i = 0; i < count; i++) {
+		uint16 nameLen = in->readUint16LE();
+		Common::String name;
+		for (uint16 j = 0; j < nameLen; j++)
+			name += (char)in->readByte();
+
+		CompiledText text;
+		text.srcSize = in->readUint32LE();
+		text.srcHash = in->readUint32LE();
+		text.len = in->readUint32LE();
+		text.lastUse = 0;
+		if (in->eos() || text.len > (uint32)(in->size() - in->pos()) ||
+				_compiledTextsSize + text.len > kMaxCompiledTextsSize) {
+			warning("Invalid compiled text cache %s", getCompiledTextName().c_str());
+			_compiledTexts.clear();
+			_compiledTextsSize = 0;
+			_compiledTextsDirty = true;
+			break;
+		}
+		byte *data = new byte[text.len];
+		in->read(data, text.len);
+		text.data = Common::SharedPtr<byte>(data, ResourceBufferDeleter());
+		_compiledTexts[name] = text;
+		_compiledTextsSize += text.len;
+	}
+
+	delete in;
+}
+
+void ResourceLoader::saveCompiledTexts() {
+	Common::OutSaveFile *out = g_system->getSavefileManager()->openForSaving(getCompiledTextName());
+	if (!out) {
+		warning("Could not write the compiled text cache %s", getCompiledTextName().c_str());
+		return;
+	}
+
+	out->writeUint32BE(COMPILEDTEXT_TAG);
+	out->writeUint32LE(TextSplitter::kCompiledTextVersion);
+	out->writeUint32LE(_compiledTexts.size());
+	for (CompiledTextMap::const_iterator i = _compiledTexts.begin(); i != _compiledTexts.end(); ++i) {
+		out->writeUint16LE(i->_key.size());
+		out->write(i->_key.c_str(), i->_key.size());
+		out->writeUint32LE(i->_value.srcSize);
+		out->writeUint32LE(i->_value.srcHash);
+		out->writeUint32LE(i->_value.len);
+		out->write(i->_value.data.get(), i->_value.len);
 	}
 
-	ResourceCache key;
-	key.fname = const_cast<char *>(filename.c_str());
+	out->finalize();
+	if (out->err())
+		warning("Could not write the compiled text cache %s", getCompiledTextName().c_str());
+	delete out;
+	_compiledTextsDirty = false;
+}
+
+bool ResourceLoader::getCompiledText(const Common::String &fname, uint32 srcSize, uint32 srcHash, Common::SharedPtr<byte> &data, uint32 &len) {
+	if (!_compiledTextsLoaded)
+		loadCompiledTexts();
+
+	CompiledTextMap::iterator i = _compiledTexts.find(fname);
+	if (i == _compiledTexts.end() || i->_value.srcSize != srcSize || i->_value.srcHash != srcHash)
+		return false;
+
+	i->_value.lastUse = ++_compiledTextsClock;
+	data = i->_value.data;
+	len = i->_value.len;
+	return true;
+}
+
+void ResourceLoader::putCompiledText(const Common::String &fname, uint32 srcSize, uint32 srcHash, const byte *data, uint32 len) {
+	if (!_compiledTextsLoaded)
+		loadCompiledTexts();
+
+	dropCompiledText(fname);
+	if (len > kMaxCompiledTextsSize)
+		return;
+
+	while (_compiledTextsSize + len > kMaxCompiledTextsSize) {
+		CompiledTextMap::iterator oldest = _compiledTexts.begin();
+		for (CompiledTextMap::iterator i = _compiledTexts.begin(); i != _compiledTexts.end(); ++i) {
+			if (i->_value.lastUse < oldest->_value.lastUse)
+				oldest = i;
+		}
+		dropCompiledText(oldest->_key);
+	}
 
-	return (ResourceLoader::ResourceCache *)bsearch(&key, _cache.begin(), _cache.size(), sizeof(ResourceCache), sortCallback);
+	byte *buf = new byte[len];
+	memcpy(buf, data, len);
+
+	CompiledText &text = _compiledTexts[fname];
+	text.srcSize = srcSize;
+	text.srcHash = srcHash;
+	text.data = Common::SharedPtr<byte>(buf, ResourceBufferDeleter());
+	text.len = len;
+	text.lastUse = ++_compiledTextsClock;
+	_compiledTextsSize += len;
+	_compiledTextsDirty = true;
+}
+
+void ResourceLoader::dropCompiledText(const Common::String &fname) {
+	CompiledTextMap::iterator i = _compiledTexts.find(fname);
+	if (i == _compiledTexts.end())
+		return;
+
+	_compiledTextsSize -= i->_value.len;
+	_compiledTexts.erase(i);
+	_compiledTextsDirty = true;
+}
+
+Common::String ResourceLoader::getPackedArchiveName() {
+	return g_grim->getGameType() == GType_MONKEY4 ? "monkey4-packed.plb" : "grim-packed.plb";
+}
+
+void ResourceLoader::clearAccessTrace() {
+	_accessTrace.clear();
+	_tracedFiles.clear();
+}
+
+void ResourceLoader::traceAccess(const Common::String &filename) {
+	if (!_tracing || _tracedFiles.contains(filename) || !_files.hasFile(filename))
+		return;
+
+	_tracedFiles[filename] = true;
+	_accessTrace.push_back(filename);
+}
+
+bool ResourceLoader::writePackedArchive(const Common::String &filename, const Common::StringArray &members) {
+	// Don't risk overwriting the packed archive while reading from it
+	if (_files.hasArchive(getPackedArchiveName())) {
+		warning("Remove %s before making a new one", getPackedArchiveName().c_str());
+		return false;
+	}
+
+	Common::DumpFile out;
+	if (!out.open(filename))
+		return false;
+
+	bool success = Lab::writePacked(&out, _files, members);
+	out.finalize();
+	return success && !out.err();
 }
 
 bool ResourceLoader::getFileExists(const Common::String &filename) {
@@ -191,6 +505,13 @@ bool ResourceLoader::getFileExists(const Common::String &filename) {
 }
 
 Common::SeekableReadStream *ResourceLoader::loadFile(Common::String &filename) {
+	bool patched = _patches.contains(filename);
+	if (patched) {
+		PatchedFileMap::const_iterator i = _patchedFiles.find(filename);
+		if (i != _patchedFiles.end() && i->_value.data)
+			return new CachedResourceStream(i->_value.data, i->_value.len);
+	}
+
 	Common::SeekableReadStream *rs = NULL;
 	if (_files.hasFile(filename))
 		rs = _files.createReadStreamForMember(filename);
@@ -200,27 +521,81 @@ Common::SeekableReadStream *ResourceLoader::loadFile(Common::String &filename) {
 		return NULL;
 
 	//Patch a file, if needed
-	if ((Common::find(_patches.begin(), _patches.end(), filename)) != _patches.end()) {
+	if (patched && !_patchedFiles.contains(filename)) {
 		Debug::debug(Debug::Patchr, "Patch requested for %s", filename.c_str());
 		Patchr p;
 		p.loadPatch(openNewStreamFile(filename + ".patchr"));
 		bool success = p.patchFile(rs, filename);
-		if (success)
+		PatchedFile &patchedFile = _patchedFiles[filename];
+		if (success) {
 			Debug::debug(Debug::Patchr, "%s successfully patched", filename.c_str());
-		else
+			patchedFile.len = rs->size();
+			byte *data = new byte[patchedFile.len];
+			rs->seek(0, SEEK_SET);
+			rs->read(data, patchedFile.len);
+			delete rs;
+			patchedFile.data = Common::SharedPtr<byte>(data, ResourceBufferDeleter());
+			rs = new CachedResourceStream(patchedFile.data, patchedFile.len);
+		} else {
 			warning("Patching of %s failed", filename.c_str());
+			patchedFile.len = 0;
+		}
 		rs->seek(0, SEEK_SET);
 	}
 	return rs;
 }
 
 Common::SeekableReadStream *ResourceLoader::openNewStreamFile(Common::String fname, bool cache) {
+	if (!_profiling) {
+		CacheUse cacheUse;
+		return openStreamFile(fname, cache, cacheUse);
+	}
+
+	uint64 start = FramePacer::getMicros();
+	CacheUse cacheUse;
+	Common::SeekableReadStream *s = openStreamFile(fname, cache, cacheUse);
+	if (!s)
+		return NULL;
+
+	uint32 readTime = (uint32)(FramePacer::getMicros() - start);
+	if (_currentProfile) {
+		// Attribute the file to the resource being loaded
+		LoadRecord &r = _currentProfile->_record;
+		if (r.bytes == 0)
+			r.cacheUse = cacheUse;
+		r.bytes += s->size();
+		r.readTime += readTime;
+	} else {
+		LoadRecord r;
+		r.type = "file";
+		r.name = fname;
+		r.caller = getCallSite();
+		r.bytes = s->size();
+		r.cacheUse = cacheUse;
+		r.readTime = readTime;
+		r.parseTime = 0;
+		r.totalTime = readTime;
+		_loadRecords.push_back(r);
+	}
+	return s;
+}
+
+Common::SeekableReadStream *ResourceLoader::openStreamFile(Common::String fname, bool cache, CacheUse &cacheUse) {
 	Common::SeekableReadStream *s;
-    fname.toLowercase();
+	fname.toLowercase();
+	// Trace here rather than in loadFile(), which prefetched files skip
+	traceAccess(fname);
 
+	cacheUse = kNotCached;
 	if (cache) {
+		// A resource halfway through the prefetch is finished first
+		if (_prefetchStream && _prefetchName == fname)
+			prefetchNext(0);
+
 		s = getFileFromCache(fname);
 		if (!s) {
+			cacheUse = kCacheMiss;
+			++_cacheMisses;
 			s = loadFile(fname);
 			if (!s)
 				return NULL;
@@ -228,27 +603,129 @@ Common::SeekableReadStream *ResourceLoader::openNewStreamFile(Common::String fna
 			uint32 size = s->size();
 			byte *buf = new byte[size];
 			s->read(buf, size);
+			delete s;
 			putIntoCache(fname, buf, size);
-			return new Common::MemoryReadStream(buf, size);
-		} else
+			return getFileFromCache(fname);
+		} else {
+			cacheUse = kCacheHit;
+			++_cacheHits;
 			return s;
+		}
 	}
 
 	return loadFile(fname);
 }
 
+Common::String ResourceLoader::getCallSite() const {
+	// Resources loaded while running a Lua opcode are accounted to it
+	if (LuaBase::instance()) {
+		lua_Object func = lua_stackedfunction(0);
+		if (func != LUA_NOOBJECT && lua_iscfunction(func)) {
+			const char *name;
+			if (*lua_getobjname(func, &name) == 'g')
+				return name;
+		}
+	}
+	return "engine";
+}
+
+static const char *cacheUseName(ResourceLoader::CacheUse cacheUse) {
+	switch (cacheUse) {
+	case ResourceLoader::kCacheHit:
+		return "hit";
+	case ResourceLoader::kCacheMiss:
+		return "miss";
+	default:
+		return "none";
+	}
+}
+
+bool ResourceLoader::dumpLoadRecords(const Common::String &filename) const {
+	Common::DumpFile out;
+	if (!out.open(filename))
+		return false;
+
+	out.writeString("type,name,caller,bytes,cache,read_us,parse_us,total_us\n");
+	for (LoadRecordList::const_iterator i = _loadRecords.begin(); i != _loadRecords.end(); ++i) {
+		out.writeString(Common::String::format("%s,%s,%s,%d,%s,%d,%d,%d\n", i->type.c_str(), i->name.c_str(),
+						i->caller.c_str(), i->bytes, cacheUseName(i->cacheUse), i->readTime, i->parseTime, i->totalTime));
+	}
+
+	out.finalize();
+	return !out.err();
+}
+
+ResourceLoadProfile::ResourceLoadProfile(const char *type, const Common::String &name) {
+	_active = g_resourceloader && g_resourceloader->isProfiling();
+	if (!_active)
+		return;
+
+	_record.type = type;
+	_record.name = name;
+	_record.caller = g_resourceloader->getCallSite();
+	_record.bytes = 0;
+	_record.cacheUse = ResourceLoader::kNotCached;
+	_record.readTime = 0;
+	_record.parseTime = 0;
+	_record.totalTime = 0;
+	_nestedTime = 0;
+	_parent = g_resourceloader->_currentProfile;
+	g_resourceloader->_currentProfile = this;
+	_start = FramePacer::getMicros();
+}
+
+ResourceLoadProfile::~ResourceLoadProfile() {
+	if (!_active)
+		return;
+
+	_record.totalTime = (uint32)(FramePacer::getMicros() - _start);
+	uint32 ownTime = _record.readTime + _nestedTime;
+	_record.parseTime = _record.totalTime > ownTime ? _record.totalTime - ownTime : 0;
+
+	g_resourceloader->_currentProfile = _parent;
+	if (_parent)
+		_parent->_nestedTime += _record.totalTime;
+	g_resourceloader->_loadRecords.push_back(_record);
+
+	Debug::debug(Debug::Resources, "Loaded %s %s: %d bytes, cache %s, read %d us, parse %d us, total %d us",
+				 _record.type.c_str(), _record.name.c_str(), _record.bytes, cacheUseName(_record.cacheUse),
+				 _record.readTime, _record.parseTime, _record.totalTime);
+}
+
 void ResourceLoader::putIntoCache(const Common::String &fname, byte *res, uint32 len) {
+	removeFromCache(fname);
+
+	_cacheLRU.push_front(fname);
+
 	ResourceCache entry;
-	entry.resPtr = res;
+	entry.resPtr = Common::SharedPtr<byte>(res, ResourceBufferDeleter());
 	entry.len = len;
-	entry.fname = new char[fname.size() + 1];
-	strcpy(entry.fname, fname.c_str());
+	entry.lruPos = _cacheLRU.begin();
+	_cache[fname] = entry;
 	_cacheMemorySize += len;
-	_cache.push_back(entry);
-	_cacheDirty = true;
+
+	// Evict the least recently used resources until we are within the budget,
+	// but always keep the one just inserted
+	while (_cacheMemoryBudget > 0 && _cacheMemorySize > _cacheMemoryBudget && _cacheLRU.size() > 1) {
+		Common::String victim = _cacheLRU.back();
+		Debug::debug(Debug::Resources, "Evicting %s from the resource cache", victim.c_str());
+		removeFromCache(victim);
+		++_cacheEvictions;
+	}
+}
+
+void ResourceLoader::removeFromCache(const Common::String &fname) {
+	ResourceCacheMap::iterator it = _cache.find(fname);
+	if (it == _cache.end())
+		return;
+
+	_cacheMemorySize -= it->_value.len;
+	_cacheLRU.erase(it->_value.lruPos);
+	_cache.erase(it);
 }
 
 Bitmap *ResourceLoader::loadBitmap(const Common::String &filename) {
+	ResourceLoadProfile profile("bitmap", filename);
 	Common::String fname = filename;
 	fname.toLowercase();
 
@@ -264,13 +741,14 @@ Bitmap *ResourceLoader::loadBitmap(const Common::String &filename) {
 }
 
 CMap *ResourceLoader::loadColormap(const Common::String &filename) {
+	ResourceLoadProfile profile("colormap", filename);
 	Common::SeekableReadStream *stream = openNewStreamFile(filename.c_str());
 	if (!stream) {
 		error("Could not find colormap %s", filename.c_str());
 	}
 
 	CMap *result = new CMap(filename, stream);
-	_colormaps.push_back(result);
+	addToIndex(_colormaps, result->_fname, result);
 
 	return result;
 }
@@ -292,6 +770,7 @@ static Common::String fixFilename(const Common::String filename, bool append = t
 }
 
 Costume *ResourceLoader::loadCostume(const Common::String &filename, Costume *prevCost) {
+	ResourceLoadProfile profile("costume", filename);
 	Common::String fname = fixFilename(filename);
 	fname.toLowercase();
 
@@ -306,6 +785,7 @@ Costume *ResourceLoader::loadCostume(const Common::String &filename, Costume *pr
 }
 
 Font *ResourceLoader::loadFont(const Common::String &filename) {
+	ResourceLoadProfile profile("font", filename);
 	Common::SeekableReadStream *stream;
 
 	stream = openNewStreamFile(filename.c_str(), true);
@@ -318,6 +798,7 @@ Font *ResourceLoader::loadFont(const Common::String &filename) {
 }
 
 KeyframeAnim *ResourceLoader::loadKeyframe(const Common::String &filename) {
+	ResourceLoadProfile profile("keyframe", filename);
 	Common::SeekableReadStream *stream;
 
 	stream = openNewStreamFile(filename.c_str());
@@ -325,12 +806,13 @@ KeyframeAnim *ResourceLoader::loadKeyframe(const Common::String &filename) {
 		error("Could not find keyframe file %s", filename.c_str());
 
 	KeyframeAnim *result = new KeyframeAnim(filename, stream);
-	_keyframeAnims.push_back(result);
+	addToIndex(_keyframeAnims, result->getFilename(), result);
 
 	return result;
 }
 
 LipSync *ResourceLoader::loadLipSync(const Common::String &filename) {
+	ResourceLoadProfile profile("lipsync", filename);
 	LipSync *result;
 	Common::SeekableReadStream *stream;
 
@@ -342,7 +824,7 @@ LipSync *ResourceLoader::loadLipSync(const Common::String &filename) {
 
 	// Some lipsync files have no data
 	if (result->isValid())
-		_lipsyncs.push_back(result);
+		addToIndex(_lipsyncs, result->getFilename(), result);
 	else {
 		delete result;
 		result = NULL;
@@ -352,6 +834,7 @@ LipSync *ResourceLoader::loadLipSync(const Common::String &filename) {
 }
 
 Material *ResourceLoader::loadMaterial(const Common::String &filename, CMap *c) {
+	ResourceLoadProfile profile("material", filename);
 	Common::String fname = fixFilename(filename, false);
 	fname.toLowercase();
 	Common::SeekableReadStream *stream;
@@ -366,6 +849,7 @@ Material *ResourceLoader::loadMaterial(const Common::String &filename, CMap *c)
 }
 
 Model *ResourceLoader::loadModel(const Common::String &filename, CMap *c, Model *parent) {
+	ResourceLoadProfile profile("model", filename);
 	Common::String fname = fixFilename(filename);
 	Common::SeekableReadStream *stream;
 
@@ -374,12 +858,13 @@ Model *ResourceLoader::loadModel(const Common::String &filename, CMap *c, Model
 		error("Could not find model %s", filename.c_str());
 
 	Model *result = new Model(filename, stream, c, parent);
-	_models.push_back(result);
+	addToIndex(_models, result->_fname, result);
 
 	return result;
 }
 
 EMIModel *ResourceLoader::loadModelEMI(const Common::String &filename, EMIModel *parent) {
+	ResourceLoadProfile profile("model", filename);
 	Common::String fname = fixFilename(filename);
 	Common::SeekableReadStream *stream;
 
@@ -396,6 +881,7 @@ EMIModel *ResourceLoader::loadModelEMI(const Common::String &filename, EMIModel
 }
 
 Skeleton *ResourceLoader::loadSkeleton(const Common::String &filename) {
+	ResourceLoadProfile profile("skeleton", filename);
 	Common::String fname = fixFilename(filename);
 	Common::SeekableReadStream *stream;
 
@@ -414,45 +900,143 @@ void ResourceLoader::uncache(const char *filename) {
 	Common::String fname = filename;
 	fname.toLowercase();
 
-	if (_cacheDirty) {
-		qsort(_cache.begin(), _cache.size(), sizeof(ResourceCache), sortCallback);
-		_cacheDirty = false;
+	removeFromCache(fname);
+}
+
+void ResourceLoader::prefetchSet(const Common::String &name) {
+	if (g_grim->findSet(name))
+		return;
+
+	Common::String fname(name);
+	// EMI-scripts refer to their .setb files as .set
+	if (g_grim->getGameType() == GType_MONKEY4)
+		fname += "b";
+	fname.toLowercase();
+
+	Debug::debug(Debug::Resources | Debug::Sets, "Prefetching set %s", fname.c_str());
+	queuePrefetch(fname);
+}
+
+void ResourceLoader::queuePrefetch(const Common::String &fname) {
+	_prefetchQueue.push(fname);
+}
+
+void ResourceLoader::updatePrefetch() {
+	uint32 budget = kPrefetchBytesPerFrame;
+	while (budget > 0 && (_prefetchStream || !_prefetchQueue.empty()))
+		budget -= prefetchNext(budget);
+}
+
+/**
+ * Reads the next piece of the queued resources into the cache, so that by
+ * the time a resource is loaded only the object has to be built. Only the
+ * LAB archives are read here, patched files are left to the regular load.
+ * The raw bytes are cached: decoding them builds the renderer data too,
+ * which can't be done ahead of time.
+ *
+ * At most maxBytes are read, 0 meaning no limit. Returns the number of
+ * bytes read.
+ */
+uint32 ResourceLoader::prefetchNext(uint32 maxBytes) {
+	if (!_prefetchStream) {
+		if (_prefetchQueue.empty())
+			return 0;
+		Common::String fname = _prefetchQueue.pop();
+
+		ResourceCacheMap::iterator it = _cache.find(fname);
+		if (it != _cache.end()) {
+			if (fname.hasSuffix(".set"))
+				queueSetReferences(it->_value.resPtr.get(), it->_value.len);
+			return 0;
+		}
+
+		if (!_files.hasFile(fname) || _patches.contains(fname))
+			return 0;
+
+		_prefetchStream = _files.createReadStreamForMember(fname);
+		if (!_prefetchStream)
+			return 0;
+
+		_prefetchName = fname;
+		_prefetchSize = _prefetchStream->size();
+		_prefetchData = new byte[_prefetchSize];
+		_prefetchRead = 0;
 	}
 
-	for (unsigned int i = 0; i < _cache.size(); i++) {
-		if (fname.compareTo(_cache[i].fname) == 0) {
-			delete[] _cache[i].fname;
-			_cacheMemorySize -= _cache[i].len;
-			delete[] _cache[i].resPtr;
-			_cache.remove_at(i);
-			_cacheDirty = true;
+	uint32 len = _prefetchSize - _prefetchRead;
+	if (maxBytes && len > maxBytes)
+		len = maxBytes;
+	uint32 read = _prefetchStream->read(_prefetchData + _prefetchRead, len);
+	_prefetchRead += read;
+	if (_prefetchRead < _prefetchSize && read == len)
+		return read;
+
+	delete _prefetchStream;
+	_prefetchStream = NULL;
+
+	Debug::debug(Debug::Resources, "Prefetched %s (%d bytes)", _prefetchName.c_str(), _prefetchRead);
+	if (_prefetchName.hasSuffix(".set"))
+		queueSetReferences(_prefetchData, _prefetchRead);
+	putIntoCache(_prefetchName, _prefetchData, _prefetchRead);
+	_prefetchData = NULL;
+	return read;
+}
+
+void ResourceLoader::queueSetReferences(const byte *data, uint32 len) {
+	// Only the text sets of Grim are looked into
+	if (len < 7 || memcmp(data, "section", 7) != 0)
+		return;
+
+	const char *text = (const char *)data;
+	uint32 start = 0;
+	while (start < len) {
+		uint32 end = start;
+		while (end < len && text[end] != '\n' && text[end] != '\r')
+			++end;
+
+		Common::String line(text + start, end - start);
+		char keyword[32], value[256];
+		if (sscanf(line.c_str(), " %31s %255s", keyword, value) == 2) {
+			// The setup backgrounds and the art of their object states
+			if ((strcmp(keyword, "background") == 0 || strcmp(keyword, "zbuffer") == 0 ||
+					strcmp(keyword, "object_art") == 0 || strcmp(keyword, "object_z") == 0) &&
+					strcmp(value, "<none>.lbm") != 0) {
+				Common::String fname(value);
+				fname.toLowercase();
+				queuePrefetch(fname);
+			}
 		}
+
+		start = end + 1;
 	}
 }
 
 void ResourceLoader::uncacheModel(Model *m) {
-	_models.remove(m);
+	removeFromIndex(_models, m->_fname, m);
 }
 
 void ResourceLoader::uncacheColormap(CMap *c) {
-	_colormaps.remove(c);
+	removeFromIndex(_colormaps, c->_fname, c);
 }
 
 void ResourceLoader::uncacheKeyframe(KeyframeAnim *k) {
-	_keyframeAnims.remove(k);
+	removeFromIndex(_keyframeAnims, k->getFilename(), k);
 }
 
 void ResourceLoader::uncacheLipSync(LipSync *s) {
-	_lipsyncs.remove(s);
+	removeFromIndex(_lipsyncs, s->getFilename(), s);
 }
 
 ModelPtr ResourceLoader::getModel(const Common::String &fname, CMap *c) {
 	Common::String filename = fname;
 	filename.toLowercase();
-	for (Common::List<Model *>::const_iterator i = _models.begin(); i != _models.end(); ++i) {
-		Model *m = *i;
-		if (filename == m->_fname && *m->_cmap == *c) {
-			return m;
+	ModelIndex::const_iterator i = _models.find(filename);
+	if (i != _models.end()) {
+		for (Common::List<Model *>::const_iterator j = i->_value.begin(); j != i->_value.end(); ++j) {
+			Model *m = *j;
+			if (*m->_cmap == *c) {
+				return m;
+			}
 		}
 	}
 
@@ -462,12 +1046,9 @@ ModelPtr ResourceLoader::getModel(const Common::String &fname, CMap *c) {
 CMapPtr ResourceLoader::getColormap(const Common::String &fname) {
 	Common::String filename = fname;
 	filename.toLowercase();
-	for (Common::List<CMap *>::const_iterator i = _colormaps.begin(); i != _colormaps.end(); ++i) {
-		CMap *c = *i;
-		if (filename.equals(c->_fname)) {
-			return c;
-		}
-	}
+	CMap *c = findInIndex(_colormaps, filename);
+	if (c)
+		return c;
 
 	return loadColormap(fname);
 }
@@ -475,12 +1056,9 @@ CMapPtr ResourceLoader::getColormap(const Common::String &fname) {
 KeyframeAnimPtr ResourceLoader::getKeyframe(const Common::String &fname) {
 	Common::String filename = fname;
 	filename.toLowercase();
-	for (Common::List<KeyframeAnim *>::const_iterator i = _keyframeAnims.begin(); i != _keyframeAnims.end(); ++i) {
-		KeyframeAnim *k = *i;
-		if (filename == k->getFilename()) {
-			return k;
-		}
-	}
+	KeyframeAnim *k = findInIndex(_keyframeAnims, filename);
+	if (k)
+		return k;
 
 	return loadKeyframe(fname);
 }
@@ -488,12 +1066,9 @@ KeyframeAnimPtr ResourceLoader::getKeyframe(const Common::String &fname) {
 LipSyncPtr ResourceLoader::getLipSync(const Common::String &fname) {
 	Common::String filename = fname;
 	filename.toLowercase();
-	for (Common::List<LipSync *>::const_iterator i = _lipsyncs.begin(); i != _lipsyncs.end(); ++i) {
-		LipSync *l = *i;
-		if (filename == l->getFilename()) {
-			return l;
-		}
-	}
+	LipSync *l = findInIndex(_lipsyncs, filename);
+	if (l)
+		return l;
 
 	return loadLipSync(fname);
 }
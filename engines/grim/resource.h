@@ -25,6 +25,11 @@
 
 #include "common/archive.h"
 #include "common/file.h"
+#include "common/hashmap.h"
+#include "common/hash-str.h"
+#include "common/ptr.h"
+#include "common/queue.h"
+#include "common/str-array.h"
 
 #include "engines/grim/object.h"
 #include "engines/grim/lua/lua.h"
@@ -44,6 +49,7 @@ class TrackedObject;
 class SaveGame;
 class Skeleton;
 class Lab;
+class ResourceLoadProfile;
 
 typedef ObjectPtr<Material> MaterialPtr;
 typedef ObjectPtr<Bitmap> BitmapPtr;
@@ -70,6 +76,9 @@ public:
 	Skeleton *loadSkeleton(const Common::String &fname);
 	Common::SeekableReadStream *openNewStreamFile(Common::String fname, bool cache = false);
 	void uncache(const char *fname);
+	void prefetchSet(const Common::String &name);
+	// Reads a slice of the queued prefetches, once per frame
+	void updatePrefetch();
 	bool getFileExists(const Common::String &filename);  //TODO: make it const again at next scummvm sync
 
 	ModelPtr getModel(const Common::String &fname, CMap *c);
@@ -82,30 +91,162 @@ public:
 	void uncacheLipSync(LipSync *l);
 
 	struct ResourceCache {
-		char *fname;
-		byte *resPtr;
+		Common::SharedPtr<byte> resPtr;
 		uint32 len;
+		Common::List<Common::String>::iterator lruPos;
 	};
 
+	uint32 getCacheHits() const { return _cacheHits; }
+	uint32 getCacheMisses() const { return _cacheMisses; }
+	uint32 getCacheEvictions() const { return _cacheEvictions; }
+	int32 getCacheMemorySize() const { return _cacheMemorySize; }
+
+	// Profiling of the resource loading, see ResourceLoadProfile
+	enum CacheUse {
+		kNotCached,
+		kCacheHit,
+		kCacheMiss
+	};
+	struct LoadRecord {
+		Common::String type;
+		Common::String name;
+		// The Lua opcode which asked for the resource, or "engine"
+		Common::String caller;
+		uint32 bytes;
+		CacheUse cacheUse;
+		// in microseconds
+		uint32 readTime;
+		uint32 parseTime;
+		uint32 totalTime;
+	};
+	typedef Common::List<LoadRecord> LoadRecordList;
+
+	void setProfiling(bool enable) { _profiling = enable; }
+	bool isProfiling() const { return _profiling; }
+	const LoadRecordList &getLoadRecords() const { return _loadRecords; }
+	void clearLoadRecords() { _loadRecords.clear(); }
+	bool dumpLoadRecords(const Common::String &filename) const;
+
+	// The order in which the files of the archives are first read, used to
+	// lay out a packed archive with writePackedArchive()
+	void setTracing(bool enable) { _tracing = enable; }
+	bool isTracing() const { return _tracing; }
+	const Common::StringArray &getAccessTrace() const { return _accessTrace; }
+	void clearAccessTrace();
+	bool writePackedArchive(const Common::String &filename, const Common::StringArray &members);
+	static Common::String getPackedArchiveName();
+
+	bool getCompiledText(const Common::String &fname, uint32 srcSize, uint32 srcHash, Common::SharedPtr<byte> &data, uint32 &len);
+	void putCompiledText(const Common::String &fname, uint32 srcSize, uint32 srcHash, const byte *data, uint32 len);
+	void dropCompiledText(const Common::String &fname);
+
 private:
+	friend class ResourceLoadProfile;
+
+	Common::SeekableReadStream *openStreamFile(Common::String fname, bool cache, CacheUse &cacheUse);
+	void traceAccess(const Common::String &filename);
 	Common::SeekableReadStream *loadFile(Common::String &filename);  //TODO: make it const again at next scummvm sync
 	Common::SeekableReadStream *getFileFromCache(const Common::String &filename);
 	ResourceLoader::ResourceCache *getEntryFromCache(const Common::String &filename);
 	void putIntoCache(const Common::String &fname, byte *res, uint32 len);
+	void removeFromCache(const Common::String &fname);
+	uint32 prefetchNext(uint32 maxBytes);
+	void queuePrefetch(const Common::String &fname);
+	void queueSetReferences(const byte *data, uint32 len);
 	void loadPatches();
+	void loadCompiledTexts();
+	Common::String getCallSite() const;
+	void saveCompiledTexts();
 
 	Common::SearchSet _files;
-	Common::List<Common::String> _patches;
+	Common::HashMap<Common::String, bool> _patches;
+
+	// Patched files are patched the first time they are opened only. A NULL
+	// data means the patching failed and the original file is used.
+	struct PatchedFile {
+		Common::SharedPtr<byte> data;
+		uint32 len;
+	};
+	typedef Common::HashMap<Common::String, PatchedFile> PatchedFileMap;
+	PatchedFileMap _patchedFiles;
 
-	Common::Array<ResourceCache> _cache;
-	bool _cacheDirty;
+	typedef Common::HashMap<Common::String, ResourceCache> ResourceCacheMap;
+	ResourceCacheMap _cache;
+	// Names of the cached resources, most recently used first
+	Common::List<Common::String> _cacheLRU;
 	int32 _cacheMemorySize;
+	// Least recently used resources are evicted above this size, 0 means no limit
+	int32 _cacheMemoryBudget;
+	uint32 _cacheHits;
+	uint32 _cacheMisses;
+	uint32 _cacheEvictions;
+
+	// The compiled forms of the text resources, by file name. They are valid
+	// as long as the size and the hash of the text match. Above a size the
+	// least recently used ones are dropped.
+	struct CompiledText {
+		uint32 srcSize, srcHash;
+		Common::SharedPtr<byte> data;
+		uint32 len;
+		uint32 lastUse;
+	};
+	typedef Common::HashMap<Common::String, CompiledText> CompiledTextMap;
+	CompiledTextMap _compiledTexts;
+	uint32 _compiledTextsSize;
+	uint32 _compiledTextsClock;
+	bool _compiledTextsLoaded;
+	bool _compiledTextsDirty;
+
+	// Resources waiting to be read into the cache, a slice per frame
+	Common::Queue<Common::String> _prefetchQueue;
+	// The resource being read
+	Common::String _prefetchName;
+	Common::SeekableReadStream *_prefetchStream;
+	byte *_prefetchData;
+	uint32 _prefetchSize, _prefetchRead;
+
+	// The loaded resources, indexed by their file name. Models sharing a name
+	// but loaded with different colormaps are kept in the same bucket.
+	typedef Common::HashMap<Common::String, Common::List<Model *> > ModelIndex;
+	typedef Common::HashMap<Common::String, Common::List<CMap *> > ColormapIndex;
+	typedef Common::HashMap<Common::String, Common::List<KeyframeAnim *> > KeyframeIndex;
+	typedef Common::HashMap<Common::String, Common::List<LipSync *> > LipSyncIndex;
+
+	bool _tracing;
+	Common::StringArray _accessTrace;
+	Common::HashMap<Common::String, bool> _tracedFiles;
+
+	bool _profiling;
+	LoadRecordList _loadRecords;
+	// The innermost load being profiled
+	ResourceLoadProfile *_currentProfile;
 
 	Common::List<EMIModel *> _emiModels;
-	Common::List<Model *> _models;
-	Common::List<CMap *> _colormaps;
-	Common::List<KeyframeAnim *> _keyframeAnims;
-	Common::List<LipSync *> _lipsyncs;
+	ModelIndex _models;
+	ColormapIndex _colormaps;
+	KeyframeIndex _keyframeAnims;
+	LipSyncIndex _lipsyncs;
+};
+
+/**
+ * Measures the loading of a resource, while the profiling of the
+ * ResourceLoader is enabled. The files opened with openNewStreamFile()
+ * during its lifetime are accounted to it, while the time spent in nested
+ * loads is excluded from its parse time.
+ */
+class ResourceLoadProfile {
+public:
+	ResourceLoadProfile(const char *type, const Common::String &name);
+	~ResourceLoadProfile();
+
+private:
+	friend class ResourceLoader;
+
+	bool _active;
+	ResourceLoader::LoadRecord _record;
+	ResourceLoadProfile *_parent;
+	uint64 _start;
+	uint32 _nestedTime;
 };
 
 extern ResourceLoader *g_resourceloader;
@@ -46,7 +46,7 @@ Set::Set(const Common::String &sceneName, Common::SeekableReadStream *data) :
 	data->read(header, 7);
 	data->seek(0, SEEK_SET);
 	if (memcmp(header, "section", 7) == 0) {
-		TextSplitter ts(data);
+		TextSplitter ts(_name, data);
 		loadText(ts);
 	} else {
 		loadBinary(data);
@@ -63,6 +63,7 @@ Set::~Set() {
 	if (_cmaps) {
 		delete[] _cmaps;
 		for (int i = 0; i < _numSetups; ++i) {
+			g_driver->forgetBackground(&_setups[i]);
 			delete _setups[i]._bkgndBm;
 			delete _setups[i]._bkgndZBm;
 		}
@@ -686,6 +687,7 @@ void Set::getSoundParameters(int *minVolume, int *maxVolume) {
 
 void Set::addObjectState(const ObjectState::Ptr &s) {
 	_states.push_front(s);
+	ObjectState::flagChanged();
 }
 
 ObjectState *Set::addObjectState(int setupID, ObjectState::Position pos, const char *bitmap, const char *zbitmap, bool transparency) {
@@ -719,6 +721,7 @@ ObjectState *Set::findState(const Common::String &filename) {
 void Set::moveObjectStateToFront(const ObjectState::Ptr &s) {
 	_states.remove(s);
 	_states.push_front(s);
+	ObjectState::flagChanged();
 	// Make the state invisible. This hides the deadbolt when brennis closes the switcher door
 	// in the server room (tu), and therefore fixes https://github.com/residualvm/residualvm/issues/24
 	s->setActiveImage(0);
@@ -727,6 +730,7 @@ void Set::moveObjectStateToFront(const ObjectState::Ptr &s) {
 void Set::moveObjectStateToBack(const ObjectState::Ptr &s) {
 	_states.remove(s);
 	_states.push_back(s);
+	ObjectState::flagChanged();
 }
 
 } // end of namespace Grim
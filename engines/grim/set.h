@@ -97,6 +97,7 @@ public:
 	void addObjectState(const ObjectState::Ptr &s);
 	void deleteObjectState(const ObjectState::Ptr &s) {
 		_states.remove(s);
+		ObjectState::flagChanged();
 	}
 
 	void moveObjectStateToFront(const ObjectState::Ptr &s);
@@ -23,8 +23,12 @@
 #include "common/util.h"
 #include "common/textconsole.h"
 #include "common/stream.h"
+#include "common/hash-str.h"
+#include "common/endian.h"
 
 #include "engines/grim/textsplit.h"
+#include "engines/grim/resource.h"
+#include "engines/grim/debug.h"
 
 namespace Grim {
 
@@ -58,14 +62,134 @@ int residualvm_vsscanf(const char *str, int field_count, const char *format, va_
 			f11, f12, f13, f14, f15, f16, f17, f18, f19, f20);
 }
 
-TextSplitter::TextSplitter(Common::SeekableReadStream *data) {
-	char *line;
-	int i;
+// The operations recorded in the compiled form of a text file. Each one
+// starts with the line it was made at and a key identifying the request,
+// e.g. the hash of the scanf format.
+enum {
+	kOpCheckString = 1,
+	kOpIsEof,
+	kOpLineNumber,
+	kOpCurrentLine,
+	kOpScan,
+	kOpExpectString,
+	kOpSetLineNumber,
+	kOpEnd
+};
+
+struct ScanConversion {
+	char type;
+	bool suppress;
+	int width;
+};
+
+// Finds the next conversion of a scanf format. Integer conversions are
+// reported as 'd', floating point ones as 'f' and sets as 's'.
+static const char *nextConversion(const char *fmt, ScanConversion &conv) {
+	while ((fmt = strchr(fmt, '%')) != NULL) {
+		fmt++;
+		if (*fmt == '%') {
+			fmt++;
+			continue;
+		}
+
+		conv.suppress = (*fmt == '*');
+		if (conv.suppress)
+			fmt++;
+		conv.width = 0;
+		while (isdigit(*fmt))
+			conv.width = conv.width * 10 + (*fmt++ - '0');
+
+		switch (*fmt) {
+		case 'd':
+		case 'i':
+		case 'u':
+		case 'x':
+		case 'X':
+		case 'o':
+			conv.type = 'd';
+			break;
+		case 'e':
+		case 'E':
+		case 'f':
+		case 'g':
+		case 'G':
+			conv.type = 'f';
+			break;
+		case 's':
+			conv.type = 's';
+			break;
+		case '[':
+			conv.type = 's';
+			fmt++;
+			if (*fmt == '^')
+				fmt++;
+			if (*fmt == ']')
+				fmt++;
+			fmt = strchr(fmt, ']');
+			if (!fmt)
+				error("Unterminated set in scan format");
+			break;
+		case 'c':
+			conv.type = 'c';
+			if (conv.width == 0)
+				conv.width = 1;
+			break;
+		case 'n':
+			conv.type = 'n';
+			break;
+		default:
+			error("Unsupported conversion '%%%c' in scan format", *fmt);
+		}
+		return fmt + 1;
+	}
+	return NULL;
+}
+
+TextSplitter::TextSplitter(Common::SeekableReadStream *data) :
+		_srcSize(0), _srcHash(0), _compiler(NULL), _replay(false), _compiledSize(0), _compiledPos(0) {
+	loadText(data);
+}
+
+TextSplitter::TextSplitter(const Common::String &fname, Common::SeekableReadStream *data) :
+		_fname(fname), _srcSize(0), _srcHash(0), _compiler(NULL), _replay(false), _compiledSize(0), _compiledPos(0) {
+	_fname.toLowercase();
+	_srcSize = data->size();
+	_stringData = new char[_srcSize + 1];
+	_srcSize = data->read(_stringData, _srcSize);
+	_stringData[_srcSize] = '\0';
+
+	// FNV-1a
+	_srcHash = 2166136261u;
+	for (uint32 i = 0; i < _srcSize; i++)
+		_srcHash = (_srcHash ^ (byte)_stringData[i]) * 16777619u;
+
+	if (g_resourceloader && g_resourceloader->getCompiledText(_fname, _srcSize, _srcHash, _compiled, _compiledSize)) {
+		Debug::debug(Debug::Resources, "Using the compiled form of %s", _fname.c_str());
+		// the text is kept in case the loader doesn't match the compiled form
+		_lines = NULL;
+		_numLines = _lineIndex = 0;
+		_currLine = NULL;
+		_replay = true;
+		return;
+	}
+
+	_compiler = new Common::Array<byte>();
+	splitLines();
+}
+
+void TextSplitter::loadText(Common::SeekableReadStream *data) {
 	uint32 len = data->size();
 
 	_stringData = new char[len + 1];
 	data->read(_stringData, len);
 	_stringData[len] = '\0';
+	splitLines();
+}
+
+void TextSplitter::splitLines() {
+	char *line;
+	int i;
+
 	// Find out how many lines of text there are
 	_numLines = _lineIndex = 0;
 	line = (char *)_stringData;
@@ -91,50 +215,264 @@ TextSplitter::TextSplitter(Common::SeekableReadStream *data) {
 }
 
 TextSplitter::~TextSplitter() {
+	// a loader which stopped short of the compiled form is recompiled, the
+	// results it got were still right
+	if (_replay && (_compiledPos >= _compiledSize || _compiled.get()[_compiledPos] != kOpEnd)) {
+		if (g_resourceloader)
+			g_resourceloader->dropCompiledText(_fname);
+	}
+
+	if (_compiler) {
+		recordOp(kOpEnd, 0);
+		if (g_resourceloader)
+			g_resourceloader->putCompiledText(_fname, _srcSize, _srcHash, _compiler->begin(), _compiler->size());
+		delete _compiler;
+	}
 	delete[] _stringData;
 	delete[] _lines;
 }
 
+char *TextSplitter::getCurrentLine() {
+	return const_cast<char *>(static_cast<const TextSplitter *>(this)->getCurrentLine());
+}
+
+const char *TextSplitter::getCurrentLine() const {
+	if (replayOp(kOpCurrentLine, 0)) {
+		if (!readByte())
+			return NULL;
+		uint32 len = readUint32();
+		const char *line = (const char *)_compiled.get() + _compiledPos;
+		if (_compiledPos + len + 1 > _compiledSize || line[len] != '\0')
+			error("The compiled form of %s is corrupted", _fname.c_str());
+		_compiledPos += len + 1;
+		return line;
+	}
+
+	if (_compiler) {
+		recordOp(kOpCurrentLine, 0);
+		writeByte(_currLine != NULL);
+		if (_currLine)
+			writeString(_currLine, strlen(_currLine));
+	}
+	return _currLine;
+}
+
+bool TextSplitter::isEof() const {
+	if (replayOp(kOpIsEof, 0))
+		return readByte();
+
+	bool eof = _lineIndex == _numLines;
+	if (_compiler) {
+		recordOp(kOpIsEof, 0);
+		writeByte(eof);
+	}
+	return eof;
+}
+
+int TextSplitter::getLineNumber() {
+	if (replayOp(kOpLineNumber, 0))
+		return (int32)readUint32();
+
+	if (_compiler) {
+		recordOp(kOpLineNumber, 0);
+		writeUint32(_lineIndex);
+	}
+	return _lineIndex;
+}
+
+void TextSplitter::setLineNumber(int line) {
+	if (replayOp(kOpSetLineNumber, line))
+		return;
+
+	if (_compiler)
+		recordOp(kOpSetLineNumber, line);
+	_lineIndex = line - 1;
+	processLine();
+}
+
 bool TextSplitter::checkString(const char *needle) {
+	if (replayOp(kOpCheckString, Common::hashit(needle)))
+		return readByte();
+
 	// checkString also needs to check for extremely optional
 	// components like "object_art" which can be missing entirely
-	if (!getCurrentLine())
-		return false;
-	else if (strstr(getCurrentLine(), needle))
-		return true;
-	else
-		return false;
+	bool found = _currLine && strstr(_currLine, needle);
+	if (_compiler) {
+		recordOp(kOpCheckString, Common::hashit(needle));
+		writeByte(found);
+	}
+	return found;
 }
 
 void TextSplitter::expectString(const char *expected) {
+	// The compiled form is only made of files which passed the check
+	if (replayOp(kOpExpectString, Common::hashit(expected)))
+		return;
+
+	if (_compiler)
+		recordOp(kOpExpectString, Common::hashit(expected));
 	if (!_currLine)
 		error("Expected `%s', got EOF", expected);
-	if (scumm_stricmp(getCurrentLine(), expected) != 0)
-		error("Expected `%s', got '%s'", expected, getCurrentLine());
+	if (scumm_stricmp(_currLine, expected) != 0)
+		error("Expected `%s', got '%s'", expected, _currLine);
 	nextLine();
 }
 
 void TextSplitter::scanString(const char *fmt, int field_count, ...) {
-	if (!_currLine)
-		error("Expected line of format '%s', got EOF", fmt);
-
 	va_list va;
 
 	va_start(va, field_count);
+	int count;
+	bool replayed = replayOp(kOpScan, Common::hashit(fmt));
+	if (replayed) {
+		count = replayScan(fmt, va);
+	} else {
+		if (!_currLine)
+			error("Expected line of format '%s', got EOF", fmt);
+		count = scanText(_currLine, field_count, fmt, va);
+	}
+	va_end(va);
+
+	if (count < field_count)
+		error("Expected line of format '%s', got '%s'", fmt, replayed ? "" : _currLine);
+
+	nextLine();
+}
+
+int TextSplitter::scanCurrentLine(int offset, const char *fmt, ...) {
+	va_list va;
 
+	va_start(va, fmt);
+	int count;
+	if (replayOp(kOpScan, Common::hashit(fmt))) {
+		count = replayScan(fmt, va);
+	} else if (!_currLine) {
+		count = -1;
+		if (_compiler) {
+			recordOp(kOpScan, Common::hashit(fmt));
+			writeUint32((uint32)count);
+		}
+	} else {
+		count = scanText(_currLine + offset, 0, fmt, va);
+	}
+	va_end(va);
+
+	return count;
+}
+
+int TextSplitter::scanText(const char *line, int field_count, const char *fmt, va_list va) {
+	ScanConversion conv;
+	const char *f;
+	va_list args;
+
+	// Conversions which are never reached leave their targets untouched, so
+	// give the %n ones a known value to be recorded
+	if (_compiler) {
+		scumm_va_copy(args, va);
+		for (f = nextConversion(fmt, conv); f; f = nextConversion(f, conv)) {
+			if (conv.suppress)
+				continue;
+			if (conv.type == 'n')
+				*va_arg(args, int *) = -1;
+			else
+				va_arg(args, void *);
+		}
+		va_end(args);
+	}
+
+	scumm_va_copy(args, va);
 #ifdef WIN32
-	if (residualvm_vsscanf(getCurrentLine(), field_count, fmt, va) < field_count)
+	int count = residualvm_vsscanf(line, field_count, fmt, args);
 #else
-	if (vsscanf(getCurrentLine(), fmt, va) < field_count)
+	int count = vsscanf(line, fmt, args);
 #endif
-		error("Expected line of format '%s', got '%s'", fmt, getCurrentLine());
-	va_end(va);
+	va_end(args);
 
-	nextLine();
+	if (!_compiler)
+		return count;
+
+	recordOp(kOpScan, Common::hashit(fmt));
+	writeUint32(count);
+
+	// Only the fields which have been read are stored
+	int stored = 0;
+	scumm_va_copy(args, va);
+	for (f = nextConversion(fmt, conv); f; f = nextConversion(f, conv)) {
+		if (conv.suppress)
+			continue;
+		if (conv.type == 'n') {
+			writeUint32(*va_arg(args, int *));
+			continue;
+		}
+
+		void *field = va_arg(args, void *);
+		if (stored >= count)
+			continue;
+		stored++;
+		switch (conv.type) {
+		case 'd':
+		case 'f':
+			writeUint32(*(uint32 *)field);
+			break;
+		case 's':
+			writeString((const char *)field, strlen((const char *)field));
+			break;
+		case 'c':
+			for (int i = 0; i < conv.width; i++)
+				writeByte(((const byte *)field)[i]);
+			break;
+		}
+	}
+	va_end(args);
+
+	return count;
+}
+
+int TextSplitter::replayScan(const char *fmt, va_list va) {
+	int count = (int32)readUint32();
+	// there was no line to scan, nothing was touched
+	if (count < 0)
+		return count;
+
+	ScanConversion conv;
+	int stored = 0;
+	for (const char *f = nextConversion(fmt, conv); f; f = nextConversion(f, conv)) {
+		if (conv.suppress)
+			continue;
+		if (conv.type == 'n') {
+			*va_arg(va, int *) = (int32)readUint32();
+			continue;
+		}
+
+		void *field = va_arg(va, void *);
+		if (stored >= count)
+			continue;
+		stored++;
+		switch (conv.type) {
+		case 'd':
+		case 'f':
+			*(uint32 *)field = readUint32();
+			break;
+		case 's': {
+			uint32 len = readUint32();
+			if (_compiledPos + len + 1 > _compiledSize)
+				error("The compiled form of %s is corrupted", _fname.c_str());
+			memcpy(field, _compiled.get() + _compiledPos, len + 1);
+			_compiledPos += len + 1;
+			break;
+		}
+		case 'c':
+			for (int i = 0; i < conv.width; i++)
+				((byte *)field)[i] = readByte();
+			break;
+		}
+	}
+
+	return count;
 }
 
 void TextSplitter::processLine() {
-	if (isEof())
+	if (_lineIndex == _numLines)
 		return;
 
 	_currLine = _lines[_lineIndex++];
@@ -152,12 +490,86 @@ void TextSplitter::processLine() {
 
 	// Skip blank lines
 	if (*_currLine == '\0')
-		nextLine();
+		processLine();
 
 	// Convert to lower case
-	if (!isEof())
+	if (_lineIndex != _numLines)
 		for (char *s = _currLine; *s != '\0'; s++)
 			*s = tolower(*s);
 }
 
+void TextSplitter::recordOp(byte op, uint32 key) const {
+	writeByte(op);
+	writeUint32(_lineIndex);
+	writeUint32(key);
+}
+
+// Returns whether the next operation of the compiled form is the given
+// one, and can be read back. Otherwise the text takes over.
+bool TextSplitter::replayOp(byte op, uint32 key) const {
+	if (!_replay)
+		return false;
+
+	byte recordedOp = readByte();
+	uint32 lineIndex = readUint32();
+	uint32 recordedKey = readUint32();
+	if (recordedOp == op && recordedKey == key)
+		return true;
+
+	const_cast<TextSplitter *>(this)->fallBackToText(lineIndex);
+	return false;
+}
+
+// Splits the text, and goes to the line the compiled form was at. The
+// requests before matched, so the loader got what the text would give.
+void TextSplitter::fallBackToText(uint32 lineIndex) {
+	Debug::debug(Debug::Resources, "The compiled form of %s is out of date", _fname.c_str());
+	_replay = false;
+	_compiled.reset();
+	_compiledSize = _compiledPos = 0;
+	if (g_resourceloader)
+		g_resourceloader->dropCompiledText(_fname);
+
+	splitLines();
+	if (lineIndex > (uint32)_numLines)
+		error("The compiled form of %s is corrupted", _fname.c_str());
+	if (lineIndex > 0 && (int)lineIndex != _lineIndex) {
+		_lineIndex = lineIndex - 1;
+		processLine();
+	}
+}
+
+void TextSplitter::writeByte(byte b) const {
+	_compiler->push_back(b);
+}
+
+void TextSplitter::writeUint32(uint32 v) const {
+	byte buf[4];
+	WRITE_LE_UINT32(buf, v);
+	for (int i = 0; i < 4; i++)
+		_compiler->push_back(buf[i]);
+}
+
+// Strings are stored with their terminator, so that they can be used
+// from the compiled data directly
+void TextSplitter::writeString(const char *str, uint32 len) const {
+	writeUint32(len);
+	for (uint32 i = 0; i <= len; i++)
+		_compiler->push_back(str[i]);
+}
+
+byte TextSplitter::readByte() const {
+	if (_compiledPos + 1 > _compiledSize)
+		error("The compiled form of %s is corrupted", _fname.c_str());
+	return _compiled.get()[_compiledPos++];
+}
+
+uint32 TextSplitter::readUint32() const {
+	if (_compiledPos + 4 > _compiledSize)
+		error("The compiled form of %s is corrupted", _fname.c_str());
+	uint32 v = READ_LE_UINT32(_compiled.get() + _compiledPos);
+	_compiledPos += 4;
+	return v;
+}
+
 } // end of namespace Grim
@@ -23,6 +23,10 @@
 #ifndef GRIM_TEXTSPLIT_HH
 #define GRIM_TEXTSPLIT_HH
 
+#include "common/array.h"
+#include "common/ptr.h"
+#include "common/str.h"
+
 namespace Common {
 class SeekableReadStream;
 }
@@ -32,22 +36,34 @@ namespace Grim {
 // A utility class to help in parsing the text-format files.  Splits
 // the text data into lines, skipping comments, trailing whitespace,
 // and empty lines.  Also folds everything to lowercase.
+//
+// When it is given the name of the file, the results of the parsing are
+// also compiled into a binary form, which the ResourceLoader keeps in a
+// cache next to the savegames. The next time the same file is loaded they
+// are read back from there, without splitting and scanning the text again.
+// Every request of the loader is recorded along with the line it was made
+// at, and checked when it is read back. If a loader changed and asks for
+// something else, the text is split again and parsing goes on from that
+// line, so kCompiledTextVersion only covers the binary form itself.
 
 class TextSplitter {
 public:
 	TextSplitter(Common::SeekableReadStream *data);
+	TextSplitter(const Common::String &fname, Common::SeekableReadStream *data);
 	~TextSplitter();
 
-	char *nextLine() {
-		processLine();
-		return _currLine;
+	void nextLine() {
+		if (!_replay)
+			processLine();
 	}
 
-	char *getCurrentLine() { return _currLine; }
-	const char *getCurrentLine() const { return _currLine; }
-	bool isEof() const { return _lineIndex == _numLines; }
-	int getLineNumber() { return _lineIndex; }
-	void setLineNumber(int line) { _lineIndex = line - 1; processLine(); }
+	// In compiled mode the returned line points into the compiled data,
+	// and it must not be modified.
+	char *getCurrentLine();
+	const char *getCurrentLine() const;
+	bool isEof() const;
+	int getLineNumber();
+	void setLineNumber(int line);
 
 	// Check if the current line contains 'needle'
 	bool checkString(const char *needle);
@@ -61,13 +77,45 @@ public:
 	// argument), bail out with an error.  Advance to the next line.
 	void scanString(const char *fmt, int field_count, ...);
 
+	// Scan the current line starting at offset, like sscanf() does. Does
+	// not bail out on errors nor advance to the next line. Returns the
+	// number of fields read.
+	int scanCurrentLine(int offset, const char *fmt, ...);
+
+	static const uint32 kCompiledTextVersion = 2;
+
 private:
 	char *_stringData;
 	char *_currLine;
 	int _numLines, _lineIndex;
 	char **_lines;
 
+	Common::String _fname;
+	uint32 _srcSize, _srcHash;
+	// The compiled form being written, when parsing the text of a named file
+	Common::Array<byte> *_compiler;
+	// The compiled form being read back, instead of the text
+	bool _replay;
+	Common::SharedPtr<byte> _compiled;
+	uint32 _compiledSize;
+	mutable uint32 _compiledPos;
+
+	void loadText(Common::SeekableReadStream *data);
+	void splitLines();
 	void processLine();
+
+	int scanText(const char *line, int field_count, const char *fmt, va_list va);
+	int replayScan(const char *fmt, va_list va);
+
+	void recordOp(byte op, uint32 key) const;
+	bool replayOp(byte op, uint32 key) const;
+	void fallBackToText(uint32 lineIndex);
+
+	void writeByte(byte b) const;
+	void writeUint32(uint32 v) const;
+	void writeString(const char *str, uint32 len) const;
+	byte readByte() const;
+	uint32 readUint32() const;
 };
 
 } // end of namespace Grim
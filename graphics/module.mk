@@ -34,6 +34,8 @@ MODULE_OBJS := \
 	tinygl/zbuffer.o \
 	tinygl/zline.o \
 	tinygl/zmath.o \
+	tinygl/zpixel.o \
+	tinygl/zraster.o \
 	tinygl/ztriangle.o \
 	tinygl/ztriangle_shadow.o
 
@@ -585,7 +585,8 @@ void tglCallList(unsigned int list) {
 }
 
 void tglFlush() {
-	// nothing to do
+	TinyGL::GLContext *c = TinyGL::gl_get_context();
+	TinyGL::ZB_flushTriangles(c->zb);
 }
 
 void tglHint(int target, int mode) {
@@ -616,3 +617,13 @@ void tglSetShadowColor(unsigned char r, unsigned char g, unsigned char b) {
 	c->zb->shadow_color_g = g << 8;
 	c->zb->shadow_color_b = b << 8;
 }
+
+void tglSetRasterThreads(int count) {
+	TinyGL::GLContext *c = TinyGL::gl_get_context();
+	TinyGL::ZB_setRasterThreads(c->zb, count);
+}
+
+int tglGetRasterThreads() {
+	TinyGL::GLContext *c = TinyGL::gl_get_context();
+	return TinyGL::ZB_getRasterThreads(c->zb);
+}
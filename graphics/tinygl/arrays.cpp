@@ -1,4 +1,3 @@
-
 #include "graphics/tinygl/zgl.h"
 
 #define VERTEX_ARRAY	0x0001
@@ -8,67 +7,197 @@
 
 namespace TinyGL {
 
-void glopArrayElement(GLContext *c, GLParam *param) {
-	int i;
+static inline const float *gl_array_element(const float *array, int stride, int idx) {
+	return (const float *)((const char *)array + idx * stride);
+}
+
+// Loads the current color, normal and texture coordinates from the enabled
+// arrays, and returns the vertex coordinates
+static void gl_load_array_element(GLContext *c, int idx, V4 *coord) {
 	int states = c->client_states;
-	int idx = param[1].i;
+	const float *a;
 
 	if (states & COLOR_ARRAY) {
-		GLParam p[5];
-		int size = c->color_array_size; 
-		i = idx * (size + c->color_array_stride);
-		p[1].f = c->color_array[i];
-		p[2].f = c->color_array[i + 1];
-		p[3].f = c->color_array[i + 2];
-		p[4].f = size > 3 ? c->color_array[i + 3] : 1.0f;
-		glopColor(c, p);  
+		GLParam p[8];
+		a = gl_array_element(c->color_array, c->color_array_stride, idx);
+		p[1].f = a[0];
+		p[2].f = a[1];
+		p[3].f = a[2];
+		p[4].f = c->color_array_size > 3 ? a[3] : 1.0f;
+		p[5].ui = (unsigned int)(p[1].f * (ZB_POINT_RED_MAX - ZB_POINT_RED_MIN) + ZB_POINT_RED_MIN);
+		p[6].ui = (unsigned int)(p[2].f * (ZB_POINT_GREEN_MAX - ZB_POINT_GREEN_MIN) + ZB_POINT_GREEN_MIN);
+		p[7].ui = (unsigned int)(p[3].f * (ZB_POINT_BLUE_MAX - ZB_POINT_BLUE_MIN) + ZB_POINT_BLUE_MIN);
+		glopColor(c, p);
 	}
 	if (states & NORMAL_ARRAY) {
-		i = idx * (3 + c->normal_array_stride);
-		c->current_normal.X = c->normal_array[i];
-		c->current_normal.Y = c->normal_array[i + 1];
-		c->current_normal.Z = c->normal_array[i + 2];
-		c->current_normal.Z = 0.0f;
+		a = gl_array_element(c->normal_array, c->normal_array_stride, idx);
+		c->current_normal.X = a[0];
+		c->current_normal.Y = a[1];
+		c->current_normal.Z = a[2];
+		c->current_normal.W = 0.0f;
 	}
 	if (states & TEXCOORD_ARRAY) {
 		int size = c->texcoord_array_size;
-		i = idx * (size + c->texcoord_array_stride);
-		c->current_tex_coord.X = c->texcoord_array[i];
-		c->current_tex_coord.Y = c->texcoord_array[i + 1];
-		c->current_tex_coord.Z = size > 2 ? c->texcoord_array[i + 2] : 0.0f;
-		c->current_tex_coord.W = size > 3 ? c->texcoord_array[i + 3] : 1.0f;
+		a = gl_array_element(c->texcoord_array, c->texcoord_array_stride, idx);
+		c->current_tex_coord.X = a[0];
+		c->current_tex_coord.Y = a[1];
+		c->current_tex_coord.Z = size > 2 ? a[2] : 0.0f;
+		c->current_tex_coord.W = size > 3 ? a[3] : 1.0f;
 	}
 	if (states & VERTEX_ARRAY) {
-		GLParam p[5];
 		int size = c->vertex_array_size;
-		i = idx * (size + c->vertex_array_stride);
-		p[1].f = c->vertex_array[i];
-		p[2].f = c->vertex_array[i + 1];
-		p[3].f = size > 2 ? c->vertex_array[i+2] : 0.0f;
-		p[4].f = size > 3 ? c->vertex_array[i+3] : 1.0f;
+		a = gl_array_element(c->vertex_array, c->vertex_array_stride, idx);
+		coord->X = a[0];
+		coord->Y = a[1];
+		coord->Z = size > 2 ? a[2] : 0.0f;
+		coord->W = size > 3 ? a[3] : 1.0f;
+	}
+}
+
+void glopArrayElement(GLContext *c, GLParam *param) {
+	V4 coord;
+
+	gl_load_array_element(c, param[1].i, &coord);
+	if (c->client_states & VERTEX_ARRAY) {
+		GLParam p[5];
+		p[1].f = coord.X;
+		p[2].f = coord.Y;
+		p[3].f = coord.Z;
+		p[4].f = coord.W;
 		glopVertex(c, p);
 	}
 }
 
-void glArrayElement(TGLint i) {
-	GLParam p[2];
-	p[0].op = OP_ArrayElement;
-	p[1].i = i;
-	gl_add_op(p);
+static inline unsigned int gl_index(int type, const void *indices, int i) {
+	switch (type) {
+	case TGL_UNSIGNED_BYTE:
+		return ((const unsigned char *)indices)[i];
+	case TGL_UNSIGNED_SHORT:
+		return ((const unsigned short *)indices)[i];
+	default:
+		return ((const unsigned int *)indices)[i];
+	}
+}
+
+void glopDrawElements(GLContext *c, GLParam *p) {
+	GLParam q[2];
+	int mode = p[1].i;
+	int count = p[2].i;
+	int type = p[3].i;
+	const void *indices = p[4].p;
+	int i;
+
+	q[1].i = mode;
+	glopBegin(c, q);
+
+	if (mode != TGL_TRIANGLES || !(c->client_states & VERTEX_ARRAY)) {
+		for (i = 0; i < count; i++) {
+			q[1].i = gl_index(type, indices, i);
+			glopArrayElement(c, q);
+		}
+		glopEnd(c, q);
+		return;
+	}
+
+	// Triangles share their vertices, so each referenced vertex is
+	// transformed, lit and projected once instead of once per corner
+	unsigned int max_index = 0;
+	for (i = 0; i < count; i++) {
+		unsigned int idx = gl_index(type, indices, i);
+		if (idx > max_index)
+			max_index = idx;
+	}
+	if ((int)max_index >= c->array_vertex_max) {
+		gl_free(c->array_vertex);
+		gl_free(c->array_vertex_done);
+		c->array_vertex_max = max_index + 1;
+		c->array_vertex = (GLVertex *)gl_malloc(c->array_vertex_max * sizeof(GLVertex));
+		c->array_vertex_done = (unsigned char *)gl_malloc(c->array_vertex_max);
+		if (!c->array_vertex || !c->array_vertex_done) {
+			error("unable to allocate GLVertex array.");
+		}
+	}
+	memset(c->array_vertex_done, 0, max_index + 1);
+
+	for (i = 0; i < count; i++) {
+		unsigned int idx = gl_index(type, indices, i);
+		if (!c->array_vertex_done[idx]) {
+			GLVertex *v = &c->array_vertex[idx];
+			gl_load_array_element(c, idx, &v->coord);
+			gl_process_vertex(c, v);
+			c->array_vertex_done[idx] = 1;
+		}
+	}
+
+	for (i = 0; i + 2 < count; i += 3) {
+		gl_draw_triangle(c, &c->array_vertex[gl_index(type, indices, i)],
+						 &c->array_vertex[gl_index(type, indices, i + 1)],
+						 &c->array_vertex[gl_index(type, indices, i + 2)]);
+	}
+
+	c->in_begin = 0;
 }
 
 void glopEnableClientState(GLContext *c, GLParam *p) {
 	c->client_states |= p[1].i;
 }
 
-void glEnableClientState(TGLenum array) {
-	GLParam p[2];
-	p[0].op = OP_EnableClientState;
+void glopDisableClientState(GLContext *c, GLParam *p) {
+	c->client_states &= p[1].i;
+}
+
+// the strides are in bytes, 0 when the elements are packed
+void glopVertexPointer(GLContext *c, GLParam *p) {
+	c->vertex_array_size = p[1].i;
+	c->vertex_array_stride = p[2].i ? p[2].i : p[1].i * sizeof(float);
+	c->vertex_array = (float *)p[3].p;
+}
+
+void glopColorPointer(GLContext *c, GLParam *p) {
+	c->color_array_size = p[1].i;
+	c->color_array_stride = p[2].i ? p[2].i : p[1].i * sizeof(float);
+	c->color_array = (float *)p[3].p;
+}
+
+void glopNormalPointer(GLContext *c, GLParam *p) {
+	c->normal_array_stride = p[1].i ? p[1].i : 3 * sizeof(float);
+	c->normal_array = (float *)p[2].p;
+}
+
+void glopTexCoordPointer(GLContext *c, GLParam *p) {
+	c->texcoord_array_size = p[1].i;
+	c->texcoord_array_stride = p[2].i ? p[2].i : p[1].i * sizeof(float);
+	c->texcoord_array = (float *)p[3].p;
+}
+
+} // end of namespace TinyGL
+
+void tglArrayElement(TGLint i) {
+	TinyGL::GLParam p[2];
+	p[0].op = TinyGL::OP_ArrayElement;
+	p[1].i = i;
+	TinyGL::gl_add_op(p);
+}
+
+void tglDrawElements(TGLenum mode, TGLsizei count, TGLenum type, const TGLvoid *indices) {
+	TinyGL::GLParam p[5];
+	assert(type == TGL_UNSIGNED_BYTE || type == TGL_UNSIGNED_SHORT || type == TGL_UNSIGNED_INT);
+	p[0].op = TinyGL::OP_DrawElements;
+	p[1].i = mode;
+	p[2].i = count;
+	p[3].i = type;
+	p[4].p = const_cast<void *>(indices);
+	TinyGL::gl_add_op(p);
+}
+
+void tglEnableClientState(TGLenum array) {
+	TinyGL::GLParam p[2];
+	p[0].op = TinyGL::OP_EnableClientState;
 
 	switch(array) {
 	case TGL_VERTEX_ARRAY:
 		p[1].i = VERTEX_ARRAY;
-		break;  
+		break;
 	case TGL_NORMAL_ARRAY:
 		p[1].i = NORMAL_ARRAY;
 		break;
@@ -82,21 +211,17 @@ void glEnableClientState(TGLenum array) {
 		assert(0);
 		break;
 	}
-	gl_add_op(p);
+	TinyGL::gl_add_op(p);
 }
 
-void glopDisableClientState(GLContext *c, GLParam *p) {
-	c->client_states &= p[1].i;
-}
+void tglDisableClientState(TGLenum array) {
+	TinyGL::GLParam p[2];
+	p[0].op = TinyGL::OP_DisableClientState;
 
-void glDisableClientState(TGLenum array) {
-	GLParam p[2];
-	p[0].op = OP_DisableClientState;
-    
 	switch(array) {
 	case TGL_VERTEX_ARRAY:
 		p[1].i = ~VERTEX_ARRAY;
-		break;  
+		break;
 	case TGL_NORMAL_ARRAY:
 		p[1].i = ~NORMAL_ARRAY;
 		break;
@@ -110,69 +235,44 @@ void glDisableClientState(TGLenum array) {
 		assert(0);
 		break;
 	}
-	gl_add_op(p);
-}
-
-void glopVertexPointer(GLContext *c, GLParam *p) {
-	c->vertex_array_size = p[1].i;
-	c->vertex_array_stride = p[2].i;
-	c->vertex_array = (float *)p[3].p;
+	TinyGL::gl_add_op(p);
 }
 
-void  glVertexPointer(TGLint size, TGLenum type, TGLsizei stride, const TGLvoid *pointer) {
-	GLParam p[4];
+void tglVertexPointer(TGLint size, TGLenum type, TGLsizei stride, const TGLvoid *pointer) {
+	TinyGL::GLParam p[4];
 	assert(type == TGL_FLOAT);
-	p[0].op = OP_VertexPointer;
+	p[0].op = TinyGL::OP_VertexPointer;
 	p[1].i = size;
 	p[2].i = stride;
 	p[3].p = const_cast<void *>(pointer);
-	gl_add_op(p);
+	TinyGL::gl_add_op(p);
 }
 
-void glopColorPointer(GLContext *c, GLParam *p) {
-	c->color_array_size = p[1].i;
-	c->color_array_stride = p[2].i;
-	c->color_array = (float *)p[3].p;  
-}
-
-void  glColorPointer(TGLint size, TGLenum type, TGLsizei stride, const TGLvoid *pointer) {
-	GLParam p[4];
+void tglColorPointer(TGLint size, TGLenum type, TGLsizei stride, const TGLvoid *pointer) {
+	TinyGL::GLParam p[4];
 	assert(type == TGL_FLOAT);
-	p[0].op = OP_ColorPointer;
+	p[0].op = TinyGL::OP_ColorPointer;
 	p[1].i = size;
 	p[2].i = stride;
 	p[3].p = const_cast<void *>(pointer);
-	gl_add_op(p);
+	TinyGL::gl_add_op(p);
 }
 
-void glopNormalPointer(GLContext *c, GLParam *p) {
-	c->normal_array_stride = p[1].i;
-	c->normal_array = (float *)p[2].p;
-}
-
-void glNormalPointer(TGLenum type, TGLsizei stride, const TGLvoid *pointer) {
-	GLParam p[3];
+void tglNormalPointer(TGLenum type, TGLsizei stride, const TGLvoid *pointer) {
+	TinyGL::GLParam p[3];
 	assert(type == TGL_FLOAT);
-	p[0].op = OP_NormalPointer;
+	p[0].op = TinyGL::OP_NormalPointer;
 	p[1].i = stride;
 	p[2].p = const_cast<void *>(pointer);
-	gl_add_op(p);
-}
-
-void glopTexCoordPointer(GLContext *c, GLParam *p) {
-	c->texcoord_array_size = p[1].i;
-	c->texcoord_array_stride = p[2].i;
-	c->texcoord_array = (float *)p[3].p;
+	TinyGL::gl_add_op(p);
 }
 
-void glTexCoordPointer(TGLint size, TGLenum type, TGLsizei stride, const TGLvoid *pointer) {
-	GLParam p[4];
+void tglTexCoordPointer(TGLint size, TGLenum type, TGLsizei stride, const TGLvoid *pointer) {
+	TinyGL::GLParam p[4];
 	assert(type == TGL_FLOAT);
-	p[0].op = OP_TexCoordPointer;
+	p[0].op = TinyGL::OP_TexCoordPointer;
 	p[1].i = size;
 	p[2].i = stride;
 	p[3].p = const_cast<void *>(pointer);
-	gl_add_op(p);
+	TinyGL::gl_add_op(p);
 }
-
-} // end of namespace TinyGL
@@ -38,8 +38,12 @@ void gl_transform_to_viewport(GLContext *c, GLVertex *v) {
   
 	// texture
 	if (c->texture_2d_enabled) {
-		v->zp.s = (int)(v->tex_coord.X * (ZB_POINT_S_MAX - ZB_POINT_S_MIN) + ZB_POINT_S_MIN);
-		v->zp.t = (int)(v->tex_coord.Y * (ZB_POINT_S_MAX - ZB_POINT_S_MIN) + ZB_POINT_S_MIN);
+		// 0 and 1 map to the centers of the first and the last texels
+		GLImage *im = &c->current_texture->images[0];
+		int smin = im->xsize ? ZB_POINT_ST_ONE / (2 * im->xsize) : ZB_POINT_S_MIN;
+		int tmin = im->ysize ? ZB_POINT_ST_ONE / (2 * im->ysize) : ZB_POINT_S_MIN;
+		v->zp.s = (int)(v->tex_coord.X * (ZB_POINT_ST_ONE - 2 * smin) + smin);
+		v->zp.t = (int)(v->tex_coord.Y * (ZB_POINT_ST_ONE - 2 * tmin) + tmin);
 	}
 }
 
@@ -389,20 +393,21 @@ void gl_draw_triangle_fill(GLContext *c, GLVertex *p0, GLVertex *p1, GLVertex *p
     
 	if (c->shadow_mode & 1) {
 		assert(c->zb->shadow_mask_buf);
-		ZB_fillTriangleFlatShadowMask(c->zb, &p0->zp, &p1->zp, &p2->zp);
+		ZB_drawTriangle(c->zb, ZB_fillTriangleFlatShadowMask, &p0->zp, &p1->zp, &p2->zp);
 	} else if (c->shadow_mode & 2) {
 		assert(c->zb->shadow_mask_buf);
-		ZB_fillTriangleFlatShadow(c->zb, &p0->zp, &p1->zp, &p2->zp);
+		ZB_drawTriangle(c->zb, ZB_fillTriangleFlatShadow, &p0->zp, &p1->zp, &p2->zp);
 	} else if (c->texture_2d_enabled) {
 #ifdef TINYGL_PROFILE
 		count_triangles_textured++;
 #endif
-		ZB_setTexture(c->zb, (PIXEL *)c->current_texture->images[0].pixmap);
-		ZB_fillTriangleMappingPerspective(c->zb, &p0->zp, &p1->zp, &p2->zp);
+		GLImage *im = &c->current_texture->images[0];
+		ZB_setTexture(c->zb, (PIXEL *)im->pixmap, im->xsize, im->ysize);
+		ZB_drawTriangle(c->zb, ZB_fillTriangleMappingPerspective, &p0->zp, &p1->zp, &p2->zp);
 	} else if (c->current_shade_model == TGL_SMOOTH) {
-		ZB_fillTriangleSmooth(c->zb, &p0->zp, &p1->zp, &p2->zp);
+		ZB_drawTriangle(c->zb, ZB_fillTriangleSmooth, &p0->zp, &p1->zp, &p2->zp);
 	} else {
-		ZB_fillTriangleFlat(c->zb, &p0->zp, &p1->zp, &p2->zp);
+		ZB_drawTriangle(c->zb, ZB_fillTriangleFlat, &p0->zp, &p1->zp, &p2->zp);
 	}
 }
 
@@ -23,11 +23,17 @@ void tglGetIntegerv(int pname,int *params) {
 		*params = T_MAX_LIGHTS;
 		break;
 	case TGL_MAX_TEXTURE_SIZE:
-		*params = 256; // not completely true, but...
+		*params = MAX_TEXTURE_SIZE;
 		break;
 	case TGL_MAX_TEXTURE_STACK_DEPTH:
 		*params = MAX_TEXTURE_STACK_DEPTH;
 		break;
+	case TGL_LIGHTING:
+		*params = c->lighting_enabled;
+		break;
+	case TGL_TEXTURE_2D:
+		*params = c->texture_2d_enabled;
+		break;
 	default:
 		error("glGet: option not implemented");
 		break;
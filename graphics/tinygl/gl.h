@@ -740,6 +740,7 @@ int tglIsList(unsigned int list);
 void tglNewList(unsigned int list, int mode);
 void tglEndList();
 void tglCallList(unsigned int list);
+void tglDeleteLists(unsigned int list, int range);
 
 // clear
 void tglClear(int mask);
@@ -787,11 +788,17 @@ void tglFrontFace(int mode);
 
 void tglSetShadowMaskBuf(unsigned char *buf);
 void tglSetShadowColor(unsigned char r, unsigned char g, unsigned char b);
+// a negative count uses one thread per processor, up to 4, and 0 or 1 draws
+// immediately. Fewer threads are used when the backend can't start them.
+// Triangles are queued until tglFlush() when more than one thread is used.
+void tglSetRasterThreads(int count);
+int tglGetRasterThreads();
 
 // opengl 1.2 arrays
 void tglEnableClientState(TGLenum array);
 void tglDisableClientState(TGLenum array);
 void tglArrayElement(TGLint i);
+void tglDrawElements(TGLenum mode, TGLsizei count, TGLenum type, const TGLvoid *indices);
 void tglVertexPointer(TGLint size, TGLenum type, TGLsizei stride, const TGLvoid *pointer);
 void tglColorPointer(TGLint size, TGLenum type, TGLsizei stride, const TGLvoid *pointer);
 void tglNormalPointer(TGLenum type, TGLsizei stride, const TGLvoid *pointer);
@@ -162,6 +162,9 @@ void glInit(void *zbuffer1) {
 
 	// opengl 1.1 arrays
 	c->client_states = 0;
+	c->array_vertex = NULL;
+	c->array_vertex_done = NULL;
+	c->array_vertex_max = 0;
 
 	// opengl 1.1 polygon offset
 	c->offset_states = 0;
@@ -184,6 +187,8 @@ void glInit(void *zbuffer1) {
 void glClose() {
 	GLContext *c = gl_get_context();
 	endSharedState(c);
+	gl_free(c->array_vertex);
+	gl_free(c->array_vertex_done);
 	gl_free(c);
 }
 
@@ -177,68 +177,79 @@ void glopCallList(GLContext *c, GLParam *p) {
 	}
 }
 
-void glNewList(unsigned int list, int mode) {
-	GLList *l;
-	GLContext *c = gl_get_context();
+} // end of namespace TinyGL
+
+void tglNewList(unsigned int list, int mode) {
+	TinyGL::GLList *l;
+	TinyGL::GLContext *c = TinyGL::gl_get_context();
 
 	assert(mode == TGL_COMPILE || mode == TGL_COMPILE_AND_EXECUTE);
 	assert(c->compile_flag == 0);
 
-	l = find_list(c, list);
+	l = TinyGL::find_list(c, list);
 	if (l)
-		delete_list(c, list);
-	l = alloc_list(c, list);
+		TinyGL::delete_list(c, list);
+	l = TinyGL::alloc_list(c, list);
 
 	c->current_op_buffer = l->first_op_buffer;
 	c->current_op_buffer_index = 0;
-  
+
 	c->compile_flag = 1;
 	c->exec_flag = (mode == TGL_COMPILE_AND_EXECUTE);
 }
 
-void glEndList() {
-	GLContext *c = gl_get_context();
-	GLParam p[1];
+void tglEndList() {
+	TinyGL::GLContext *c = TinyGL::gl_get_context();
+	TinyGL::GLParam p[1];
 
 	assert(c->compile_flag == 1);
-  
+
 	// end of list
-	p[0].op = OP_EndList;
-	gl_compile_op(c, p);
-  
+	p[0].op = TinyGL::OP_EndList;
+	TinyGL::gl_compile_op(c, p);
+
 	c->compile_flag = 0;
 	c->exec_flag = 1;
 }
 
-int glIsList(unsigned int list) {
-	GLContext *c = gl_get_context();
-	GLList *l;
-	l = find_list(c, list);
+int tglIsList(unsigned int list) {
+	TinyGL::GLContext *c = TinyGL::gl_get_context();
+	TinyGL::GLList *l;
+	l = TinyGL::find_list(c, list);
 	return (l != NULL);
 }
 
-unsigned int glGenLists(int range) {
-	GLContext *c = gl_get_context();
+// returns 0 when no range of free lists is left, 0 is never a list
+unsigned int tglGenLists(int range) {
+	TinyGL::GLContext *c = TinyGL::gl_get_context();
 	int count, i, list;
-	GLList **lists;
+	TinyGL::GLList **lists;
 
 	lists = c->shared_state.lists;
 	count = 0;
-	for (i = 0; i < MAX_DISPLAY_LISTS; i++) {
+	for (i = 1; i < MAX_DISPLAY_LISTS; i++) {
 		if (!lists[i]) {
 			count++;
 			if (count == range) {
 				list = i - range + 1;
 				for (i = 0; i < range; i++) {
-					alloc_list(c, list + i);
+					TinyGL::alloc_list(c, list + i);
 				}
 				return list;
 			}
 		} else {
-			count=0;
+			count = 0;
 		}
 	}
 	return 0;
 }
 
-} // end of namespace TinyGL
+void tglDeleteLists(unsigned int list, int range) {
+	TinyGL::GLContext *c = TinyGL::gl_get_context();
+
+	assert(c->compile_flag == 0);
+	for (unsigned int i = list; i < list + range; i++) {
+		if (i < MAX_DISPLAY_LISTS && TinyGL::find_list(c, i))
+			TinyGL::delete_list(c, i);
+	}
+}
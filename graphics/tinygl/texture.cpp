@@ -22,6 +22,9 @@ static void free_texture(GLContext *c, int h) {
 	GLImage *im;
 	int i;
 
+	// queued triangles may still sample the pixmaps
+	ZB_flushTriangles(c->zb);
+
 	t = find_texture(c, h);
 	if (!t->prev) {
 		ht = &c->shared_state.texture_hash_table[t->handle % TEXTURE_HASH_TABLE_SIZE];
@@ -79,6 +82,13 @@ void glopBindTexture(GLContext *c, GLParam *p) {
 	c->current_texture = t;
 }
 
+static int gl_texture_size(int size) {
+	int s = 2;
+	while (s < size && s < MAX_TEXTURE_SIZE)
+		s <<= 1;
+	return s;
+}
+
 void glopTexImage2D(GLContext *c, GLParam *p) {
 	int target = p[1].i;
 	int level = p[2].i;
@@ -98,16 +108,20 @@ void glopTexImage2D(GLContext *c, GLParam *p) {
 		error("glTexImage2D: combination of parameters not handled");
 	}
 
+	// the mappers take power of two sizes up to MAX_TEXTURE_SIZE, the other
+	// images are resized to the next one that fits
+	int xsize = gl_texture_size(width);
+	int ysize = gl_texture_size(height);
 	do_free = 0;
-	if (width != 256 || height != 256) {
-		pixels1 = (unsigned char *)gl_malloc(256 * 256 * 4);
+	if (width != xsize || height != ysize) {
+		pixels1 = (unsigned char *)gl_malloc(xsize * ysize * 4);
 		// no interpolation is done here to respect the original image aliasing !
-		//gl_resizeImageNoInterpolate(pixels1, 256, 256, (unsigned char *)pixels, width, height);
+		//gl_resizeImageNoInterpolate(pixels1, xsize, ysize, (unsigned char *)pixels, width, height);
 		// used interpolation anyway, it look much better :) --- aquadran
-		gl_resizeImage(pixels1, 256, 256, (unsigned char *)pixels, width, height);
+		gl_resizeImage(pixels1, xsize, ysize, (unsigned char *)pixels, width, height);
 		do_free = 1;
-		width = 256;
-		height = 256;
+		width = xsize;
+		height = ysize;
 	} else {
 		pixels1 = (unsigned char *)pixels;
 	}
@@ -115,8 +129,10 @@ void glopTexImage2D(GLContext *c, GLParam *p) {
 	im = &c->current_texture->images[level];
 	im->xsize = width;
 	im->ysize = height;
-	if (im->pixmap)
+	if (im->pixmap) {
+		ZB_flushTriangles(c->zb);
 		gl_free(im->pixmap);
+	}
 	im->pixmap = gl_malloc(width * height * 3);
 	if (im->pixmap)
 		gl_convertRGB_to_5R6G5B8A((unsigned short *)im->pixmap, pixels1, width, height);
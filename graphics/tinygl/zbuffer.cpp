@@ -2,6 +2,7 @@
 // Z buffer: 16,32 bits Z / 16 bits color
 
 #include "common/scummsys.h"
+#include "common/util.h"
 
 #include "graphics/tinygl/zbuffer.h"
 
@@ -54,8 +55,15 @@ ZBuffer *ZB_open(int xsize, int ysize, int mode, void *frame_buffer) {
 	}
 
 	zb->current_texture = NULL;
+	zb->current_texture_wbits = 8;
+	zb->current_texture_hbits = 8;
 	zb->shadow_mask_buf = NULL;
 
+	zb->band_ymin = 0;
+	zb->band_ymax = zb->ysize;
+	zb->raster_queue = NULL;
+	ZB_resetDirty(zb);
+
 	return zb;
 error:
 	gl_free(zb);
@@ -63,6 +71,8 @@ error:
 }
 
 void ZB_close(ZBuffer *zb) {
+	ZB_setRasterThreads(zb, 0);
+
     if (zb->frame_buffer_allocated)
 		gl_free(zb->pbuf);
 
@@ -74,11 +84,15 @@ void ZB_close(ZBuffer *zb) {
 void ZB_resize(ZBuffer *zb, void *frame_buffer, int xsize, int ysize) {
 	int size;
 
+	ZB_flushTriangles(zb);
+
 	// xsize must be a multiple of 4
 	xsize = xsize & ~3;
 
 	zb->xsize = xsize;
 	zb->ysize = ysize;
+	zb->band_ymax = ysize;
+	ZB_resetDirty(zb);
 	zb->linesize = (xsize * PSZB + 3) & ~3;
 
 	size = zb->xsize * zb->ysize * sizeof(unsigned short);
@@ -119,6 +133,8 @@ static void ZB_copyBuffer(ZBuffer *zb, void *buf, int linesize) {
 }
 
 void ZB_copyFrameBuffer(ZBuffer *zb, void *buf, int linesize) {
+	ZB_flushTriangles(zb);
+
 	switch (zb->mode) {
 	case ZB_MODE_5R6G5B:
 		ZB_copyBuffer(zb, buf, linesize);
@@ -177,6 +193,8 @@ void ZB_clear(ZBuffer *zb, int clear_z, int z, int clear_color, int r, int g, in
 	int y;
 	PIXEL *pp;
 
+	ZB_flushTriangles(zb);
+
 	if (clear_z) {
 		memset_s(zb->zbuf, z, zb->xsize * zb->ysize);
 	}
@@ -190,7 +208,26 @@ void ZB_clear(ZBuffer *zb, int clear_z, int z, int clear_color, int r, int g, in
 			memset_s(pp, color, zb->xsize);
 			pp = (PIXEL *)((char *)pp + zb->linesize);
 		}
+		ZB_addDirty(zb, 0, 0, zb->xsize - 1, zb->ysize - 1);
 	}
 }
 
+void ZB_addDirty(ZBuffer *zb, int x1, int y1, int x2, int y2) {
+	if (x1 < zb->dirty_xmin)
+		zb->dirty_xmin = MAX(x1, 0);
+	if (y1 < zb->dirty_ymin)
+		zb->dirty_ymin = MAX(y1, 0);
+	if (x2 > zb->dirty_xmax)
+		zb->dirty_xmax = MIN(x2, zb->xsize - 1);
+	if (y2 > zb->dirty_ymax)
+		zb->dirty_ymax = MIN(y2, zb->ysize - 1);
+}
+
+void ZB_resetDirty(ZBuffer *zb) {
+	zb->dirty_xmin = zb->xsize;
+	zb->dirty_ymin = zb->ysize;
+	zb->dirty_xmax = -1;
+	zb->dirty_ymax = -1;
+}
+
 } // end of namespace TinyGL
@@ -13,6 +13,8 @@ namespace TinyGL {
 #define ZB_POINT_S_MAX ( (1 << 22) - (1 << 13) )
 #define ZB_POINT_T_MIN ( (1 << 21) )
 #define ZB_POINT_T_MAX ( (1 << 30) - (1 << 21) )
+// the perspective mapping takes s and t of 1.0 at this value
+#define ZB_POINT_ST_ONE ( (1 << 22) )
 
 #define ZB_POINT_RED_MIN ( (1 << 10) )
 #define ZB_POINT_RED_MAX ( (1 << 16) - (1 << 10) )
@@ -30,6 +32,8 @@ typedef unsigned short PIXEL;
 #define PSZB 2 
 #define PSZSH 4 
 
+struct ZRasterQueue;
+
 typedef struct {
 	int xsize, ysize;
 	int linesize; // line size, in bytes
@@ -47,6 +51,16 @@ typedef struct {
 	unsigned char *dctable;
 	int *ctable;
 	PIXEL *current_texture;
+	// log2 of the width and the height of the current texture
+	int current_texture_wbits, current_texture_hbits;
+
+	// triangles only write the scanlines in [band_ymin, band_ymax)
+	int band_ymin, band_ymax;
+	// deferred triangles waiting for the rasterizer threads, if any
+	ZRasterQueue *raster_queue;
+	// bounding box of what was drawn since the last ZB_resetDirty(),
+	// inclusive and empty while dirty_xmin > dirty_xmax
+	int dirty_xmin, dirty_ymin, dirty_xmax, dirty_ymax;
 } ZBuffer;
 
 typedef struct {
@@ -65,6 +79,8 @@ void ZB_resize(ZBuffer *zb, void *frame_buffer, int xsize, int ysize);
 void ZB_clear(ZBuffer *zb, int clear_z, int z, int clear_color, int r, int g, int b);
 // linesize is in BYTES
 void ZB_copyFrameBuffer(ZBuffer *zb, void *buf, int linesize);
+void ZB_addDirty(ZBuffer *zb, int x1, int y1, int x2, int y2);
+void ZB_resetDirty(ZBuffer *zb);
 
 // zline.c
 
@@ -74,7 +90,7 @@ void ZB_line_z(ZBuffer * zb, ZBufferPoint * p1, ZBufferPoint * p2);
 
 // ztriangle.c */
 
-void ZB_setTexture(ZBuffer *zb, PIXEL *texture);
+void ZB_setTexture(ZBuffer *zb, PIXEL *texture, int width, int height);
 void ZB_fillTriangleFlat(ZBuffer *zb, ZBufferPoint *p1, 
 						 ZBufferPoint *p2, ZBufferPoint *p3);
 void ZB_fillTriangleFlatShadowMask(ZBuffer *zb, ZBufferPoint *p1, 
@@ -90,6 +106,28 @@ void ZB_fillTriangleMappingPerspective(ZBuffer *zb, ZBufferPoint *p0,
 typedef void (*ZB_fillTriangleFunc)(ZBuffer *, ZBufferPoint *,
 									ZBufferPoint *, ZBufferPoint *);
 
+// zraster.c
+
+void ZB_setRasterThreads(ZBuffer *zb, int count);
+int ZB_getRasterThreads(ZBuffer *zb);
+void ZB_drawTriangle(ZBuffer *zb, ZB_fillTriangleFunc fill,
+					 ZBufferPoint *p0, ZBufferPoint *p1, ZBufferPoint *p2);
+void ZB_flushTriangles(ZBuffer *zb);
+
+// zpixel.cpp
+
+// scale for ZB_grayRow() that gives the mean of the channels
+#define ZB_GRAY_SCALE 21846
+
+// dst[i] is the gray of (r + g + b) * scale >> 16, over the 8 bit channels
+// of src[i]. dst may be src.
+void ZB_grayRow(PIXEL *dst, const PIXEL *src, int count, unsigned int scale);
+// the mean of the channels of the pixels, as 8 bit levels
+void ZB_grayRow8(unsigned char *dst, const PIXEL *src, int count);
+void ZB_addRow8(unsigned short *sums, const unsigned char *src, int count);
+// copies the pixels that aren't key
+void ZB_copyRowColorKey(PIXEL *dst, const PIXEL *src, int count, PIXEL key);
+
 // memory.c
 void gl_free(void *p);
 void *gl_malloc(int size);
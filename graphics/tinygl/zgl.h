@@ -35,11 +35,12 @@ enum {
 #define MAX_TEXTURE_STACK_DEPTH		8
 #define MAX_NAME_STACK_DEPTH		64
 #define MAX_TEXTURE_LEVELS			11
+#define MAX_TEXTURE_SIZE			1024
 #define T_MAX_LIGHTS				32
 
 #define VERTEX_HASH_SIZE 1031
 
-#define MAX_DISPLAY_LISTS 1024
+#define MAX_DISPLAY_LISTS 4096
 #define OP_BUFFER_MAX_SIZE 512
 
 #define TGL_OFFSET_FILL    0x1
@@ -251,6 +252,10 @@ typedef struct GLContext {
 	int texcoord_array_size;
 	int texcoord_array_stride;
 	int client_states;
+	// vertices processed by glDrawElements, indexed like the arrays
+	GLVertex *array_vertex;
+	unsigned char *array_vertex_done;
+	int array_vertex_max;
 
 	// opengl 1.1 polygon offset
 	float offset_factor;
@@ -280,6 +285,7 @@ void gl_add_op(GLParam *p);
 
 // clip.c
 void gl_transform_to_viewport(GLContext *c, GLVertex *v);
+void gl_process_vertex(GLContext *c, GLVertex *v);
 void gl_draw_triangle(GLContext *c, GLVertex *p0, GLVertex *p1, GLVertex *p2);
 void gl_draw_line(GLContext *c, GLVertex *p0, GLVertex *p1);
 void gl_draw_point(GLContext *c, GLVertex *p0);
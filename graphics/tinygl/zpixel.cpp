@@ -0,0 +1,96 @@
+
+// 2D operations on rows of pixels, for the screen effects and the blits
+// done outside of the rasterizer. The SIMD paths take 8 pixels at a time,
+// the scalar loops finish the rows and stand in for them elsewhere.
+
+#include "graphics/tinygl/zbuffer.h"
+#include "graphics/tinygl/zsimd.h"
+
+namespace TinyGL {
+
+static inline unsigned int grayLevel(PIXEL pixel, unsigned int scale) {
+	unsigned int sum = ((pixel & 0xF800) >> 8) + ((pixel & 0x07E0) >> 3) + ((pixel & 0x001F) << 3);
+	return (sum * scale) >> 16;
+}
+
+static inline PIXEL grayToPixel(unsigned int level) {
+	return (PIXEL)(((level & 0xF8) << 8) | ((level & 0xFC) << 3) | (level >> 3));
+}
+
+#ifdef TINYGL_SIMD_SPANS
+
+static inline __m128i ZB_grayLevels8(__m128i pixels, __m128i scale) {
+	__m128i r = _mm_srli_epi16(_mm_and_si128(pixels, _mm_set1_epi16((short)0xF800)), 8);
+	__m128i g = _mm_srli_epi16(_mm_and_si128(pixels, _mm_set1_epi16(0x07E0)), 3);
+	__m128i b = _mm_slli_epi16(_mm_and_si128(pixels, _mm_set1_epi16(0x001F)), 3);
+	// the sums fit in 10 bits, the high half of the product is the shift
+	return _mm_mulhi_epu16(_mm_add_epi16(_mm_add_epi16(r, g), b), scale);
+}
+
+static inline __m128i ZB_grayToPixels8(__m128i levels) {
+	__m128i r = _mm_slli_epi16(_mm_and_si128(levels, _mm_set1_epi16(0xF8)), 8);
+	__m128i g = _mm_slli_epi16(_mm_and_si128(levels, _mm_set1_epi16(0xFC)), 3);
+	return _mm_or_si128(_mm_or_si128(r, g), _mm_srli_epi16(levels, 3));
+}
+
+#endif
+
+void ZB_grayRow(PIXEL *dst, const PIXEL *src, int count, unsigned int scale) {
+	int i = 0;
+#ifdef TINYGL_SIMD_SPANS
+	const __m128i scale8 = _mm_set1_epi16((short)scale);
+	for (; i + 8 <= count; i += 8) {
+		__m128i levels = ZB_grayLevels8(_mm_loadu_si128((const __m128i *)(src + i)), scale8);
+		_mm_storeu_si128((__m128i *)(dst + i), ZB_grayToPixels8(levels));
+	}
+#endif
+	for (; i < count; i++)
+		dst[i] = grayToPixel(grayLevel(src[i], scale));
+}
+
+void ZB_grayRow8(unsigned char *dst, const PIXEL *src, int count) {
+	int i = 0;
+#ifdef TINYGL_SIMD_SPANS
+	const __m128i scale8 = _mm_set1_epi16(ZB_GRAY_SCALE);
+	for (; i + 8 <= count; i += 8) {
+		__m128i levels = ZB_grayLevels8(_mm_loadu_si128((const __m128i *)(src + i)), scale8);
+		_mm_storel_epi64((__m128i *)(dst + i), _mm_packus_epi16(levels, levels));
+	}
+#endif
+	for (; i < count; i++)
+		dst[i] = (unsigned char)grayLevel(src[i], ZB_GRAY_SCALE);
+}
+
+void ZB_addRow8(unsigned short *sums, const unsigned char *src, int count) {
+	int i = 0;
+#ifdef TINYGL_SIMD_SPANS
+	const __m128i zero = _mm_setzero_si128();
+	for (; i + 16 <= count; i += 16) {
+		__m128i bytes = _mm_loadu_si128((const __m128i *)(src + i));
+		__m128i lo = _mm_loadu_si128((const __m128i *)(sums + i));
+		__m128i hi = _mm_loadu_si128((const __m128i *)(sums + i + 8));
+		_mm_storeu_si128((__m128i *)(sums + i), _mm_add_epi16(lo, _mm_unpacklo_epi8(bytes, zero)));
+		_mm_storeu_si128((__m128i *)(sums + i + 8), _mm_add_epi16(hi, _mm_unpackhi_epi8(bytes, zero)));
+	}
+#endif
+	for (; i < count; i++)
+		sums[i] += src[i];
+}
+
+void ZB_copyRowColorKey(PIXEL *dst, const PIXEL *src, int count, PIXEL key) {
+	int i = 0;
+#ifdef TINYGL_SIMD_SPANS
+	const __m128i key8 = _mm_set1_epi16((short)key);
+	for (; i + 8 <= count; i += 8) {
+		__m128i pixels = _mm_loadu_si128((const __m128i *)(src + i));
+		__m128i mask = _mm_xor_si128(_mm_cmpeq_epi16(pixels, key8), _mm_set1_epi32(-1));
+		ZB_blend8(dst + i, pixels, mask);
+	}
+#endif
+	for (; i < count; i++) {
+		if (src[i] != key)
+			dst[i] = src[i];
+	}
+}
+
+} // end of namespace TinyGL
@@ -0,0 +1,293 @@
+
+// Deferred triangle rasterization: when rasterizer threads are enabled the
+// filled triangles are queued instead of being drawn right away. On flush
+// they are binned into horizontal bands of the screen and the bands are
+// filled in parallel. A band is only ever filled by one thread, in the order
+// the triangles were submitted, so the result matches immediate drawing.
+
+#include "common/array.h"
+#include "common/system.h"
+#include "graphics/tinygl/zbuffer.h"
+
+namespace TinyGL {
+
+static inline void addTriangleDirty(ZBuffer *zb, const ZBufferPoint *p0, const ZBufferPoint *p1, const ZBufferPoint *p2) {
+	ZB_addDirty(zb, MIN(p0->x, MIN(p1->x, p2->x)), MIN(p0->y, MIN(p1->y, p2->y)),
+				MAX(p0->x, MAX(p1->x, p2->x)), MAX(p0->y, MAX(p1->y, p2->y)));
+}
+
+#ifdef USE_TINYGL_THREADS
+
+enum {
+	kMaxRasterThreads = 16,
+	// beyond that the bands get too thin to pay for the threads, and the
+	// game has other uses for the processors
+	kDefaultMaxRasterThreads = 4,
+	// more bands than threads, so a crowded band doesn't stall the flush
+	kBandsPerThread = 4,
+	// bounds the memory used by the queue, flushed early when reached
+	kMaxQueuedTriangles = 16384
+};
+
+struct ZRasterCommand {
+	ZB_fillTriangleFunc fill;
+	ZBufferPoint p[3];
+	// the zbuffer state the fill function reads, as it was at submission
+	PIXEL *current_texture;
+	int current_texture_wbits, current_texture_hbits;
+	unsigned char *shadow_mask_buf;
+	int shadow_color_r, shadow_color_g, shadow_color_b;
+};
+
+struct ZRasterQueue {
+	ZBuffer *zb;
+	int numThreads; // including the flushing thread
+	int numWorkers;
+	OSystem::ThreadRef workers[kMaxRasterThreads];
+
+	OSystem::MutexRef mutex;
+	OSystem::ConditionRef workCond;
+	OSystem::ConditionRef doneCond;
+	bool quit;
+	unsigned int generation; // bumped for every flush
+	int nextBand;
+	int bandsDone;
+
+	int numBands;
+	int bandHeight;
+	Common::Array<ZRasterCommand> commands;
+	Common::Array<Common::Array<int> > bins;
+};
+
+static void rasterizeBand(ZRasterQueue *q, int band) {
+	// each band gets its own copy of the zbuffer: the buffers are shared,
+	// the band limits and the per triangle state are not
+	ZBuffer zb = *q->zb;
+	zb.band_ymin = band * q->bandHeight;
+	zb.band_ymax = MIN(zb.band_ymin + q->bandHeight, zb.ysize);
+
+	const Common::Array<int> &bin = q->bins[band];
+	for (uint i = 0; i < bin.size(); i++) {
+		const ZRasterCommand &cmd = q->commands[bin[i]];
+		// the fill functions scribble on the points
+		ZBufferPoint p0 = cmd.p[0], p1 = cmd.p[1], p2 = cmd.p[2];
+
+		zb.current_texture = cmd.current_texture;
+		zb.current_texture_wbits = cmd.current_texture_wbits;
+		zb.current_texture_hbits = cmd.current_texture_hbits;
+		zb.shadow_mask_buf = cmd.shadow_mask_buf;
+		zb.shadow_color_r = cmd.shadow_color_r;
+		zb.shadow_color_g = cmd.shadow_color_g;
+		zb.shadow_color_b = cmd.shadow_color_b;
+		cmd.fill(&zb, &p0, &p1, &p2);
+	}
+}
+
+static void rasterizeBands(ZRasterQueue *q) {
+	for (;;) {
+		int band = -1;
+		g_system->lockMutex(q->mutex);
+		if (q->nextBand < q->numBands)
+			band = q->nextBand++;
+		g_system->unlockMutex(q->mutex);
+		if (band < 0)
+			break;
+
+		rasterizeBand(q, band);
+
+		g_system->lockMutex(q->mutex);
+		if (++q->bandsDone == q->numBands)
+			g_system->signalCondition(q->doneCond);
+		g_system->unlockMutex(q->mutex);
+	}
+}
+
+static int rasterThread(void *arg) {
+	ZRasterQueue *q = (ZRasterQueue *)arg;
+	unsigned int generation = 0;
+
+	g_system->lockMutex(q->mutex);
+	for (;;) {
+		while (!q->quit && q->generation == generation)
+			g_system->waitCondition(q->workCond, q->mutex);
+		if (q->quit)
+			break;
+		generation = q->generation;
+		g_system->unlockMutex(q->mutex);
+
+		rasterizeBands(q);
+
+		g_system->lockMutex(q->mutex);
+	}
+	g_system->unlockMutex(q->mutex);
+	return 0;
+}
+
+static void destroyQueue(ZRasterQueue *q) {
+	if (q->mutex) {
+		g_system->lockMutex(q->mutex);
+		q->quit = true;
+		if (q->workCond)
+			g_system->signalCondition(q->workCond);
+		g_system->unlockMutex(q->mutex);
+	}
+
+	for (int i = 0; i < q->numWorkers; i++)
+		g_system->joinThread(q->workers[i]);
+
+	if (q->doneCond)
+		g_system->deleteCondition(q->doneCond);
+	if (q->workCond)
+		g_system->deleteCondition(q->workCond);
+	if (q->mutex)
+		g_system->deleteMutex(q->mutex);
+	delete q;
+}
+
+void ZB_setRasterThreads(ZBuffer *zb, int count) {
+	if (count < 0) {
+		// one thread per processor, up to a few
+		count = CLIP(g_system->getCPUCount(), 1, (int)kDefaultMaxRasterThreads);
+	}
+	count = MIN<int>(count, kMaxRasterThreads);
+
+	if (zb->raster_queue) {
+		if (zb->raster_queue->numThreads == count)
+			return;
+		ZB_flushTriangles(zb);
+		destroyQueue(zb->raster_queue);
+		zb->raster_queue = NULL;
+	}
+
+	// a single thread has nothing to share the work with, draw immediately
+	if (count <= 1)
+		return;
+
+	ZRasterQueue *q = new ZRasterQueue();
+	q->zb = zb;
+	q->numWorkers = 0;
+	q->quit = false;
+	q->generation = 0;
+	q->nextBand = 0;
+	q->bandsDone = 0;
+	q->numBands = 0;
+	q->bandHeight = 0;
+	q->mutex = g_system->createMutex();
+	q->workCond = g_system->createCondition();
+	q->doneCond = g_system->createCondition();
+
+	// the backend may not offer threads, then the triangles are drawn
+	// immediately as with a single thread
+	for (int i = 0; q->mutex && q->workCond && q->doneCond && i < count - 1; i++) {
+		q->workers[q->numWorkers] = g_system->createThread(rasterThread, q);
+		if (!q->workers[q->numWorkers])
+			break;
+		q->numWorkers++;
+	}
+	if (q->numWorkers == 0) {
+		destroyQueue(q);
+		return;
+	}
+	q->numThreads = q->numWorkers + 1;
+
+	zb->raster_queue = q;
+}
+
+int ZB_getRasterThreads(ZBuffer *zb) {
+	return zb->raster_queue ? zb->raster_queue->numThreads : 1;
+}
+
+void ZB_drawTriangle(ZBuffer *zb, ZB_fillTriangleFunc fill,
+					 ZBufferPoint *p0, ZBufferPoint *p1, ZBufferPoint *p2) {
+	addTriangleDirty(zb, p0, p1, p2);
+
+	ZRasterQueue *q = zb->raster_queue;
+	if (!q) {
+		fill(zb, p0, p1, p2);
+		return;
+	}
+
+	if (q->commands.size() >= kMaxQueuedTriangles)
+		ZB_flushTriangles(zb);
+
+	ZRasterCommand cmd;
+	cmd.fill = fill;
+	cmd.p[0] = *p0;
+	cmd.p[1] = *p1;
+	cmd.p[2] = *p2;
+	cmd.current_texture = zb->current_texture;
+	cmd.current_texture_wbits = zb->current_texture_wbits;
+	cmd.current_texture_hbits = zb->current_texture_hbits;
+	cmd.shadow_mask_buf = zb->shadow_mask_buf;
+	cmd.shadow_color_r = zb->shadow_color_r;
+	cmd.shadow_color_g = zb->shadow_color_g;
+	cmd.shadow_color_b = zb->shadow_color_b;
+	q->commands.push_back(cmd);
+}
+
+void ZB_flushTriangles(ZBuffer *zb) {
+	ZRasterQueue *q = zb->raster_queue;
+	if (!q || q->commands.empty())
+		return;
+
+	// bin the triangles by the bands their vertical extent covers. A worker
+	// can only pick a band after the new count is published below, so the
+	// bins can be filled without holding the lock.
+	int numBands = MIN(q->numThreads * kBandsPerThread, zb->ysize);
+	int bandHeight = (zb->ysize + numBands - 1) / numBands;
+	if ((int)q->bins.size() < numBands)
+		q->bins.resize(numBands);
+	for (int i = 0; i < numBands; i++)
+		q->bins[i].resize(0);
+
+	for (uint i = 0; i < q->commands.size(); i++) {
+		const ZBufferPoint *p = q->commands[i].p;
+		int ymin = MIN(p[0].y, MIN(p[1].y, p[2].y));
+		int ymax = MAX(p[0].y, MAX(p[1].y, p[2].y));
+		int first = CLIP(ymin, 0, zb->ysize - 1) / bandHeight;
+		int last = CLIP(ymax, 0, zb->ysize - 1) / bandHeight;
+		for (int band = first; band <= last; band++)
+			q->bins[band].push_back(i);
+	}
+
+	g_system->lockMutex(q->mutex);
+	q->numBands = numBands;
+	q->bandHeight = bandHeight;
+	q->nextBand = 0;
+	q->bandsDone = 0;
+	q->generation++;
+	g_system->signalCondition(q->workCond);
+	g_system->unlockMutex(q->mutex);
+
+	// lend a hand instead of idling, then wait for the bands still in flight
+	rasterizeBands(q);
+
+	g_system->lockMutex(q->mutex);
+	while (q->bandsDone < q->numBands)
+		g_system->waitCondition(q->doneCond, q->mutex);
+	g_system->unlockMutex(q->mutex);
+
+	q->commands.resize(0);
+}
+
+#else
+
+void ZB_setRasterThreads(ZBuffer *, int) {
+}
+
+int ZB_getRasterThreads(ZBuffer *) {
+	return 1;
+}
+
+void ZB_drawTriangle(ZBuffer *zb, ZB_fillTriangleFunc fill,
+					 ZBufferPoint *p0, ZBufferPoint *p1, ZBufferPoint *p2) {
+	addTriangleDirty(zb, p0, p1, p2);
+	fill(zb, p0, p1, p2);
+}
+
+void ZB_flushTriangles(ZBuffer *) {
+}
+
+#endif
+
+} // end of namespace TinyGL
@@ -0,0 +1,115 @@
+#ifndef GRAPHICS_TINYGL_ZSIMD_H_
+#define GRAPHICS_TINYGL_ZSIMD_H_
+
+#include "graphics/tinygl/zbuffer.h"
+
+// SSE2 kernels for the span fillers, 8 pixels per iteration. SSE2 is part
+// of the x86-64 baseline, so it is picked at compile time; other targets
+// keep using the scalar loops.
+
+#if defined(__SSE2__) && !defined(TINYGL_NO_SIMD)
+
+#define TINYGL_SIMD_SPANS
+
+#include <emmintrin.h>
+
+namespace TinyGL {
+
+struct ZSpan8 {
+	__m128i zlo, zhi; // 32 bit depths of the pixels 0-3 and 4-7
+	__m128i mask;     // 16 bit lanes, all ones where the pixel passes
+};
+
+// The depth of pixel i is z + i * dzdx. The test is the same ZCMP as the
+// scalar code, against both the 16 and the 32 bit z buffer.
+// Returns false when no pixel of the span passes.
+static inline bool ZB_depthTest8(ZSpan8 &span, const unsigned short *pz, const unsigned int *pz_2,
+								 unsigned int z, int dzdx) {
+	const __m128i bias = _mm_set1_epi32((int)0x80000000);
+	const __m128i zero = _mm_setzero_si128();
+
+	span.zlo = _mm_set_epi32(z + 3 * dzdx, z + 2 * dzdx, z + dzdx, z);
+	span.zhi = _mm_add_epi32(span.zlo, _mm_set1_epi32(4 * dzdx));
+
+	// zz fits in 18 bits, the signed compare is safe
+	__m128i z16 = _mm_loadu_si128((const __m128i *)pz);
+	__m128i failLo = _mm_cmplt_epi32(_mm_srli_epi32(span.zlo, ZB_POINT_Z_FRAC_BITS), _mm_unpacklo_epi16(z16, zero));
+	__m128i failHi = _mm_cmplt_epi32(_mm_srli_epi32(span.zhi, ZB_POINT_Z_FRAC_BITS), _mm_unpackhi_epi16(z16, zero));
+
+	// SSE2 only compares signed, flip the sign bits for the unsigned one
+	__m128i z32 = _mm_loadu_si128((const __m128i *)pz_2);
+	failLo = _mm_or_si128(failLo, _mm_cmplt_epi32(_mm_xor_si128(span.zlo, bias), _mm_xor_si128(z32, bias)));
+	z32 = _mm_loadu_si128((const __m128i *)(pz_2 + 4));
+	failHi = _mm_or_si128(failHi, _mm_cmplt_epi32(_mm_xor_si128(span.zhi, bias), _mm_xor_si128(z32, bias)));
+
+	__m128i fail = _mm_packs_epi32(failLo, failHi);
+	span.mask = _mm_xor_si128(fail, _mm_set1_epi32(-1));
+	return _mm_movemask_epi8(fail) != 0xffff;
+}
+
+static inline void ZB_blend8(void *dst, __m128i src, __m128i mask) {
+	__m128i old = _mm_loadu_si128((const __m128i *)dst);
+	_mm_storeu_si128((__m128i *)dst, _mm_or_si128(_mm_and_si128(mask, src), _mm_andnot_si128(mask, old)));
+}
+
+// Writes the colors and the 32 bit depths of the pixels set in mask
+static inline void ZB_writeSpan8(PIXEL *pp, unsigned int *pz_2, __m128i colors, const ZSpan8 &span, __m128i mask) {
+	ZB_blend8(pp, colors, mask);
+	ZB_blend8(pz_2, span.zlo, _mm_unpacklo_epi16(mask, mask));
+	ZB_blend8(pz_2 + 4, span.zhi, _mm_unpackhi_epi16(mask, mask));
+}
+
+// Modulates 5R6G5B texels by 5R6G5B lights, channel by channel
+static inline __m128i ZB_modulate8(__m128i texels, __m128i lights) {
+	// the channels are widened to 8 bits, their products fit in 16 bits
+	__m128i r = _mm_mullo_epi16(_mm_srli_epi16(_mm_and_si128(texels, _mm_set1_epi16((short)0xF800)), 8),
+								_mm_srli_epi16(_mm_and_si128(lights, _mm_set1_epi16((short)0xF800)), 8));
+	__m128i g = _mm_mullo_epi16(_mm_srli_epi16(_mm_and_si128(texels, _mm_set1_epi16(0x07E0)), 3),
+								_mm_srli_epi16(_mm_and_si128(lights, _mm_set1_epi16(0x07E0)), 3));
+	__m128i b = _mm_mullo_epi16(_mm_slli_epi16(_mm_and_si128(texels, _mm_set1_epi16(0x001F)), 3),
+								_mm_slli_epi16(_mm_and_si128(lights, _mm_set1_epi16(0x001F)), 3));
+
+	r = _mm_slli_epi16(_mm_and_si128(_mm_srli_epi16(r, 8), _mm_set1_epi16(0xF8)), 8);
+	g = _mm_slli_epi16(_mm_and_si128(_mm_srli_epi16(g, 8), _mm_set1_epi16(0xFC)), 3);
+	b = _mm_srli_epi16(b, 11);
+	return _mm_or_si128(_mm_or_si128(r, g), b);
+}
+
+// The smooth filler packs r, g and b into one word, each channel in its own
+// field with a guard bit above it that is cleared after every step. So the
+// fields never carry into each other, and stepping k times is the same as
+// adding once the delta stepped k times from 0.
+static inline unsigned int ZB_stepRGB(unsigned int rgb, unsigned int drgbdx) {
+	return (rgb + drgbdx) & (~0x00200800);
+}
+
+static inline __m128i ZB_packedRGBToPixels(__m128i rgb) {
+	__m128i tmp = _mm_and_si128(rgb, _mm_set1_epi32((int)0xF81F07E0));
+	tmp = _mm_or_si128(tmp, _mm_srli_epi32(tmp, 16));
+	// sign extend the low halves, so the saturating pack keeps them as is
+	return _mm_srai_epi32(_mm_slli_epi32(tmp, 16), 16);
+}
+
+// Colors of the next 8 pixels from the packed rgb, drgb4 is the delta
+// stepped 4 times
+static inline __m128i ZB_smoothColors8(unsigned int rgb, unsigned int drgbdx, unsigned int drgb4) {
+	unsigned int rgb1 = ZB_stepRGB(rgb, drgbdx);
+	unsigned int rgb2 = ZB_stepRGB(rgb1, drgbdx);
+	unsigned int rgb3 = ZB_stepRGB(rgb2, drgbdx);
+	__m128i lo = _mm_set_epi32(rgb3, rgb2, rgb1, rgb);
+	__m128i hi = _mm_and_si128(_mm_add_epi32(lo, _mm_set1_epi32(drgb4)), _mm_set1_epi32(~0x00200800));
+	return _mm_packs_epi32(ZB_packedRGBToPixels(lo), ZB_packedRGBToPixels(hi));
+}
+
+// All ones in the lanes whose shadow mask byte is set
+static inline __m128i ZB_shadowMask8(const unsigned char *pm) {
+	const __m128i zero = _mm_setzero_si128();
+	__m128i m = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)pm), zero);
+	return _mm_xor_si128(_mm_cmpeq_epi16(m, zero), _mm_set1_epi32(-1));
+}
+
+} // end of namespace TinyGL
+
+#endif
+
+#endif
@@ -1,6 +1,7 @@
 
 #include "common/endian.h"
 #include "graphics/tinygl/zbuffer.h"
+#include "graphics/tinygl/zsimd.h"
 
 namespace TinyGL {
 
@@ -24,6 +25,15 @@ void ZB_fillTriangleFlat(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoint *p1, ZBuffe
 	z += dzdx;								\
 }
 
+#ifdef TINYGL_SIMD_SPANS
+#define PUT_PIXELS8() {											\
+	ZSpan8 span;												\
+	if (ZB_depthTest8(span, pz, pz_2, z, dzdx))					\
+		ZB_writeSpan8(pp, pz_2, _mm_set1_epi16(color), span, span.mask);	\
+	z += 8 * dzdx;												\
+}
+#endif
+
 #include "graphics/tinygl/ztriangle.h"
 }
 
@@ -70,6 +80,7 @@ void ZB_fillTriangleSmooth(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoint *p1, ZBuf
 	rgb |= (g1 >> 5) & 0x000007FF;					\
 	rgb |= (b1 << 5) & 0x001FF000;					\
 	drgbdx = _drgbdx;								\
+	PUT_PIXELS8();									\
 	while (n >= 3) {								\
 		PUT_PIXEL(0);								\
 		PUT_PIXEL(1);								\
@@ -89,11 +100,39 @@ void ZB_fillTriangleSmooth(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoint *p1, ZBuf
 	}												\
 }
 
+#ifdef TINYGL_SIMD_SPANS
+#define PUT_PIXELS8()									\
+	if (n >= 7) {										\
+		unsigned int drgb4 = 0;							\
+		for (int _a = 0; _a < 4; _a++)					\
+			drgb4 = ZB_stepRGB(drgb4, drgbdx);			\
+		while (n >= 7) {								\
+			ZSpan8 span;								\
+			if (ZB_depthTest8(span, pz, pz_2, z, dzdx))	\
+				ZB_writeSpan8(pp, pz_2, ZB_smoothColors8(rgb, drgbdx, drgb4), span, span.mask);	\
+			rgb = ZB_stepRGB(ZB_stepRGB(rgb, drgb4), drgb4);	\
+			z += 8 * dzdx;								\
+			pz += 8;									\
+			pz_2 += 8;									\
+			pp += 8;									\
+			n -= 8;										\
+		}												\
+	}
+#else
+#define PUT_PIXELS8()
+#endif
+
 #include "graphics/tinygl/ztriangle.h"
 }
 
-void ZB_setTexture(ZBuffer *zb, PIXEL *texture) {
-	zb->current_texture=texture;
+void ZB_setTexture(ZBuffer *zb, PIXEL *texture, int width, int height) {
+	zb->current_texture = texture;
+	zb->current_texture_wbits = 0;
+	while ((1 << zb->current_texture_wbits) < width)
+		zb->current_texture_wbits++;
+	zb->current_texture_hbits = 0;
+	while ((1 << zb->current_texture_hbits) < height)
+		zb->current_texture_hbits++;
 }
 
 void ZB_fillTriangleMapping(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoint *p1, ZBufferPoint *p2) {
@@ -117,11 +156,32 @@ void ZB_fillTriangleMapping(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoint *p1, ZBu
 	t += dtdx;								\
 }
 
+#ifdef TINYGL_SIMD_SPANS
+#define PUT_PIXELS8() {										\
+	ZSpan8 span;											\
+	if (ZB_depthTest8(span, pz, pz_2, z, dzdx)) {			\
+		PIXEL texels[8];									\
+		for (int _a = 0; _a < 8; _a++) {					\
+			texels[_a] = texture[((t & 0x3FC00000) | s) >> 14];	\
+			s += dsdx;										\
+			t += dtdx;										\
+		}													\
+		ZB_writeSpan8(pp, pz_2, _mm_loadu_si128((const __m128i *)texels), span, span.mask);	\
+	} else {												\
+		s += 8 * dsdx;										\
+		t += 8 * dtdx;										\
+	}														\
+	z += 8 * dzdx;											\
+}
+#endif
+
 #include "graphics/tinygl/ztriangle.h"
 }
 
 void ZB_fillTriangleMappingPerspective(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoint *p1, ZBufferPoint *p2) {
 	PIXEL *texture;
+	int wbits, sshift, tshift;
+	unsigned int smask, tmask;
 	float fdzdx, fndzdx, ndszdx, ndtzdx;
 	int _drgbdx;
 
@@ -132,7 +192,7 @@ void ZB_fillTriangleMappingPerspective(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoi
 	unsigned short *pz1;
 	unsigned int *pz2;
 	PIXEL *pp1;
-	int part, update_left, update_right;
+	int part, update_left, update_right, y;
 
 	int nb_lines, dx1, dy1, tmp, dx2, dy2;
 
@@ -234,7 +294,13 @@ void ZB_fillTriangleMappingPerspective(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoi
 	pz1 = zb->zbuf + p0->y * zb->xsize;
 	pz2 = zb->zbuf2 + p0->y * zb->xsize;
 
+	// s and t are 1.0 at 1 << 22, the texture is wbits by hbits wide
 	texture = zb->current_texture;
+	wbits = zb->current_texture_wbits;
+	sshift = 22 - wbits;
+	tshift = 22 - zb->current_texture_hbits;
+	smask = (1 << wbits) - 1;
+	tmask = (1 << zb->current_texture_hbits) - 1;
 	fdzdx = (float)dzdx;
 	fndzdx = NB_INTERP * fdzdx;
 	ndszdx = NB_INTERP * dszdx;
@@ -243,6 +309,8 @@ void ZB_fillTriangleMappingPerspective(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoi
 	_drgbdx |= (dgdx / (1 << 5)) & 0x000007FF;
 	_drgbdx |= ((dbdx / (1 << 7)) << 12) & 0x001FF000;
 
+	y = p0->y;
+
 	for (part = 0; part < 2; part++) {
 		if (part == 0) {
 			if (fz0 > 0) {
@@ -333,7 +401,9 @@ void ZB_fillTriangleMappingPerspective(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoi
 
 		while (nb_lines > 0) {
 			nb_lines--;
-			{
+			if (y >= zb->band_ymax)
+				return;
+			if (y >= zb->band_ymin) {
 				register unsigned short *pz;
 				register unsigned int *pz_2;
 				register PIXEL *pp;
@@ -365,12 +435,38 @@ void ZB_fillTriangleMappingPerspective(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoi
 						fz += fndzdx;
 						zinv = (float)(1.0 / fz);
 					}
+#ifdef TINYGL_SIMD_SPANS
+					{
+						ZSpan8 span;
+						if (ZB_depthTest8(span, pz, pz_2, z, dzdx)) {
+							PIXEL texels[8], lights[8];
+							unsigned short opaque[8];
+							for (int _a = 0; _a < 8; _a++) {
+								char *ptr = (char *)(texture) + ((((t >> tshift) & tmask) << wbits) | ((s >> sshift) & smask)) * 3;
+								texels[_a] = READ_UINT16(ptr);
+								opaque[_a] = *(ptr + 2) == '\xff' ? 0xffff : 0;
+								tmp = rgb & 0xF81F07E0;
+								lights[_a] = tmp | (tmp >> 16);
+								s += dsdx;
+								t += dtdx;
+								rgb = (rgb + drgbdx) & (~0x00200800);
+							}
+							__m128i mask = _mm_and_si128(span.mask, _mm_loadu_si128((const __m128i *)opaque));
+							__m128i colors = ZB_modulate8(_mm_loadu_si128((const __m128i *)texels),
+														  _mm_loadu_si128((const __m128i *)lights));
+							ZB_writeSpan8(pp, pz_2, colors, span, mask);
+						} else {
+							// s and t are recomputed for the next pixels, rgb isn't
+							for (int _a = 0; _a < 8; _a++)
+								rgb = (rgb + drgbdx) & (~0x00200800);
+						}
+						z += 8 * dzdx;
+					}
+#else
 					for (int _a = 0; _a < 8; _a++) {
 						zz = z >> ZB_POINT_Z_FRAC_BITS;
 						if ((ZCMP(zz, pz[_a])) && (ZCMP(z, pz_2[_a]))) {
-							unsigned ttt = (t & 0x003FC000) >> (9 - PSZSH);
-							unsigned sss = (s & 0x003FC000) >> (17 - PSZSH);
-							char *ptr = (char *)(texture) + (((ttt | sss) >> 1) * 3);
+							char *ptr = (char *)(texture) + ((((t >> tshift) & tmask) << wbits) | ((s >> sshift) & smask)) * 3;
 							PIXEL pixel = READ_UINT16(ptr);
 							char alpha = *(ptr + 2);
 							if (alpha == '\xff') {
@@ -395,6 +491,7 @@ void ZB_fillTriangleMappingPerspective(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoi
 						t += dtdx;
 						rgb = (rgb + drgbdx) & (~0x00200800);
 					}
+#endif
 
 					pz += NB_INTERP;
 					pz_2 += NB_INTERP;
@@ -418,9 +515,7 @@ void ZB_fillTriangleMappingPerspective(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoi
 					{
 						zz = z >> ZB_POINT_Z_FRAC_BITS;
 						if ((ZCMP(zz, pz[0])) && (ZCMP(z, pz_2[0]))) {
-							unsigned ttt = (t & 0x003FC000) >> (9 - PSZSH);
-							unsigned sss = (s & 0x003FC000) >> (17 - PSZSH);
-							char *ptr = (char *)(texture) + (((ttt | sss) >> 1) * 3);
+							char *ptr = (char *)(texture) + ((((t >> tshift) & tmask) << wbits) | ((s >> sshift) & smask)) * 3;
 							PIXEL pixel = READ_UINT16(ptr);
 							char alpha = *(ptr + 2);
 							if (alpha == '\xff') {
@@ -486,6 +581,7 @@ void ZB_fillTriangleMappingPerspective(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoi
 			pp1 = (PIXEL *)((char *)pp1 + zb->linesize);
 			pz1 += zb->xsize;
 			pz2 += zb->xsize;
+			y++;
 		}
 	}
 }
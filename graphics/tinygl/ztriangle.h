@@ -7,7 +7,7 @@
 	unsigned short *pz1;
 	unsigned int *pz2;
 	PIXEL *pp1;
-	int part, update_left, update_right;
+	int part, update_left, update_right, y;
 
 	int nb_lines, dx1, dy1, tmp, dx2, dy2;
 
@@ -138,6 +138,9 @@
 
 	DRAW_INIT();
 
+	// only the scanlines inside [band_ymin, band_ymax) are written
+	y = p0->y;
+
 	for (part = 0; part < 2; part++) {
 		if (part == 0) {
 			if (fz > 0) {
@@ -241,9 +244,11 @@
 
 		while (nb_lines>0) {
 			nb_lines--;
+			if (y >= zb->band_ymax)
+				return;
 #ifndef DRAW_LINE
 			// generic draw line
-			{
+			if (y >= zb->band_ymin) {
 				register PIXEL *pp;
 				register int n;
 #ifdef INTERP_Z
@@ -280,6 +285,15 @@
 #ifdef INTERP_STZ
 				sz = sz1;
 				tz = tz1;
+#endif
+#ifdef PUT_PIXELS8
+				while (n >= 7) {
+					PUT_PIXELS8();
+					pz += 8;
+					pz_2 += 8;
+					pp = (PIXEL *)((char *)pp + 8 * PSZB);
+					n -= 8;
+				}
 #endif
 				while (n >= 3) {
 					PUT_PIXEL(0);
@@ -304,7 +318,8 @@
 				}
 			}
 #else
-			DRAW_LINE();
+			if (y >= zb->band_ymin)
+				DRAW_LINE();
 #endif
       
 			// left edge
@@ -355,6 +370,7 @@
 			pp1 = (PIXEL *)((char *)pp1 + zb->linesize);
 			pz1 += zb->xsize;
 			pz2 += zb->xsize;
+			y++;
 		}
 	}
 }
@@ -367,3 +383,4 @@
 #undef DRAW_INIT
 #undef DRAW_LINE  
 #undef PUT_PIXEL
+#undef PUT_PIXELS8
@@ -1,5 +1,8 @@
 
+#include "common/scummsys.h"
+
 #include "graphics/tinygl/zbuffer.h"
+#include "graphics/tinygl/zsimd.h"
 
 namespace TinyGL {
 
@@ -9,7 +12,7 @@ void ZB_fillTriangleFlatShadowMask(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoint *
 	ZBufferPoint *t, *pr1 = 0, *pr2 = 0, *l1 = 0, *l2 = 0;
 	float fdx1, fdx2, fdy1, fdy2, fz;
 	unsigned char *pm1;
-	int part, update_left, update_right;
+	int part, update_left, update_right, y;
 
 	int nb_lines, dx1, dy1, tmp, dx2, dy2;
 
@@ -57,6 +60,8 @@ void ZB_fillTriangleFlatShadowMask(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoint *
 
 	pm1 = zb->shadow_mask_buf + zb->xsize * p0->y;
 
+	y = p0->y;
+
 	for (part = 0; part < 2; part++) {
 		if (part == 0) {
 			if (fz > 0) {
@@ -121,25 +126,17 @@ void ZB_fillTriangleFlatShadowMask(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoint *
 		// we draw all the scan line of the part
 		while (nb_lines > 0) {
 			nb_lines--;
+			if (y >= zb->band_ymax)
+				return;
 			// generic draw line
-			{
+			if (y >= zb->band_ymin) {
 				register unsigned char *pm;
 				register int n;
 
 				n = (x2 >> 16) - x1;
 				pm = pm1 + x1;
-				while (n >= 3) {
-					for (int a = 0; a <= 3; a++) {
-						pm[a] = 0xff;
-					}
-					pm += 4;
-					n -= 4;
-				}
-				while (n >= 0) {
-					pm[0] = 0xff;
-					pm += 1;
-					n -= 1;
-				}
+				if (n >= 0)
+					memset(pm, 0xff, n + 1);
 			}
 	  
 			// left edge
@@ -156,6 +153,7 @@ void ZB_fillTriangleFlatShadowMask(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoint *
 
 			// screen coordinates
 			pm1 = pm1 + zb->xsize;
+			y++;
 		}
 	}
 }
@@ -168,7 +166,7 @@ void ZB_fillTriangleFlatShadow(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoint *p1,
 	unsigned short *pz1;
 	unsigned int *pz2;
 	PIXEL *pp1;
-	int part, update_left, update_right;
+	int part, update_left, update_right, y;
 
 	int nb_lines, dx1, dy1, tmp, dx2, dy2;
 
@@ -228,6 +226,8 @@ void ZB_fillTriangleFlatShadow(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoint *p1,
 
 	color = RGB_TO_PIXEL(zb->shadow_color_r, zb->shadow_color_g, zb->shadow_color_b);
 
+	y = p0->y;
+
 	for (part = 0; part < 2; part++) {
 		if (part == 0) {
 			if (fz > 0) {
@@ -298,8 +298,10 @@ void ZB_fillTriangleFlatShadow(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoint *p1,
 
 		while (nb_lines > 0) {
 			nb_lines--;
+			if (y >= zb->band_ymax)
+				return;
 			// generic draw line
-			{
+			if (y >= zb->band_ymin) {
 				register PIXEL *pp;
 				register unsigned char *pm;
 				register int n;
@@ -313,10 +315,23 @@ void ZB_fillTriangleFlatShadow(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoint *p1,
 				pz = pz1 + x1;
 				pz_2 = pz2 + x1;
 				z = z1;
+#ifdef TINYGL_SIMD_SPANS
+				while (n >= 7) {
+					ZSpan8 span;
+					if (ZB_depthTest8(span, pz, pz_2, z, dzdx))
+						ZB_writeSpan8(pp, pz_2, _mm_set1_epi16(color), span, _mm_and_si128(span.mask, ZB_shadowMask8(pm)));
+					z += 8 * dzdx;
+					pz += 8;
+					pz_2 += 8;
+					pm += 8;
+					pp = (PIXEL *)((char *)pp + 8 * PSZB);
+					n -= 8;
+				}
+#endif
 				while (n >= 3) {
 					for (int a = 0; a < 4; a++) {
 						zz = z >> ZB_POINT_Z_FRAC_BITS;
-						if ((ZCMP(zz, pz[a])) && (ZCMP(z, pz_2[a])) && pm[0]) {
+						if ((ZCMP(zz, pz[a])) && (ZCMP(z, pz_2[a])) && pm[a]) {
 							pp[a] = color;
 							pz_2[a] = z;
 						}
@@ -361,6 +376,7 @@ void ZB_fillTriangleFlatShadow(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoint *p1,
 			pz1 += zb->xsize;
 			pz2 += zb->xsize;
 			pm1 += zb->xsize;
+			y++;
 		}
 	}
 }